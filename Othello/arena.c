@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "bitboard.h"
+#include "computer.h"
+#include "eval.h"
+#include "nn.h"
+#include "platform.h"
+#include "record.h"
+#include "rng.h"
+#include "tt.h"
+
+#define MAX_WORKERS 256
+
+typedef struct {
+    Strategy strategy[2];     // [0] = A, [1] = B
+    Evaluator evaluator[2];
+    int games;
+    int opening_plies;
+    int clock_ms, increment_ms;   // game clock per side, 0 = per-move time only
+    uint64_t seed;
+    RecordWriter* record;     // NULL unless -r
+    FILE* stats;              // per-move JSON lines, NULL unless -x
+
+    Mutex lock;
+    int next_game;
+    int wins, draws, losses;  // from A's point of view
+    long long disc_diff;
+    int overruns;             // games in which a clock went below zero
+} Arena;
+
+static void log_stats(Arena* arena, int g, int ply, const Position* pos, Strategy strategy, const SearchStats* stats) {
+    char fields[512];
+
+    stats_format_json(stats, fields, sizeof(fields));
+    mutex_lock(&arena->lock);
+    fprintf(arena->stats, "{\"game\":%d,\"ply\":%d,\"empties\":%d,\"strategy\":\"%s\",%s}\n", g, ply,
+        64 - bb_count(pos->own | pos->opp), strategy_name(strategy), fields);
+    mutex_unlock(&arena->lock);
+}
+
+// Plays game g and returns the final disc difference for A. Games come in pairs
+// that share a random opening with colours swapped. Everything random in game g
+// derives from (seed, g), so a run is reproducible whatever -j is.
+static int play_game(Arena* arena, int g, GameRecord* record, int* overrun) {
+    Rng opening;
+    ComputerContext ctx;
+    rng_seed(&opening, arena->seed * 0x9e3779b97f4a7c15ULL + (uint64_t)(g / 2));
+    computer_init(&ctx, arena->seed * 0xc2b2ae3d27d4eb4fULL + (uint64_t)g);
+
+    int a_color = (g % 2 == 0) ? BLACK : WHITE;
+    int board[8][8];
+    Position pos;
+    int passes = 0;
+    int clock[2] = { arena->clock_ms, arena->clock_ms };    // [0] = A, [1] = B
+
+    init_board(board);
+    bb_from_board(board, BLACK, &pos);
+    record_init(record, arena->seed, (uint32_t)g, arena->strategy[a_color == BLACK ? 0 : 1],
+        arena->strategy[a_color == BLACK ? 1 : 0]);
+
+    for (int ply = 0; passes < 2; ply++) {
+        uint64_t moves = bb_moves(pos.own, pos.opp);
+        Undo undo;
+        int sq;
+
+        if (!moves) {
+            bb_pass(&pos);
+            passes++;
+            continue;
+        }
+        if (passes) record_add(record, -1);
+        passes = 0;
+
+        if (ply < arena->opening_plies) {
+            for (int i = (int)rng_below(&opening, (uint32_t)bb_count(moves)); i > 0; i--) moves &= moves - 1;
+            sq = bb_first(moves);
+        }
+        else {
+            int side = pos.color == a_color ? 0 : 1;
+            SearchLimits limits;
+            search_limits_init(&limits, arena->strategy[side]);
+            limits.evaluator = arena->evaluator[side];
+            limits.clock_ms = clock[side];
+            limits.increment_ms = arena->increment_ms;
+            int64_t start = now_ms();
+            sq = computer_move(&ctx, &pos, &limits);
+            if (arena->clock_ms > 0) {
+                clock[side] -= (int)(now_ms() - start);
+                if (clock[side] < 0) *overrun = 1;
+                clock[side] += arena->increment_ms;
+            }
+            if (arena->stats) log_stats(arena, g, ply, &pos, limits.strategy, &ctx.stats);
+        }
+        bb_make_move(&pos, sq, &undo);
+        record_add(record, sq);
+    }
+
+    uint64_t black = pos.color == BLACK ? pos.own : pos.opp;
+    record->discs[0] = (uint8_t)bb_count(black);
+    record->discs[1] = (uint8_t)bb_count((pos.own | pos.opp) ^ black);
+    int diff = bb_count(pos.own) - bb_count(pos.opp);
+    computer_free(&ctx);
+    return pos.color == a_color ? diff : -diff;
+}
+
+static void worker_main(void* arg) {
+    Arena* arena = arg;
+
+    for (;;) {
+        mutex_lock(&arena->lock);
+        int g = arena->next_game++;
+        mutex_unlock(&arena->lock);
+        if (g >= arena->games) break;
+
+        GameRecord record;
+        int overrun = 0;
+        int diff = play_game(arena, g, &record, &overrun);
+
+        mutex_lock(&arena->lock);
+        if (arena->record) record_write(arena->record, &record);
+        if (diff > 0) arena->wins++;
+        else if (diff < 0) arena->losses++;
+        else arena->draws++;
+        arena->disc_diff += diff;
+        arena->overruns += overrun;
+        mutex_unlock(&arena->lock);
+    }
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: othello_arena [options] <strategy A> <strategy B>\n"
+        "  strategies: random, maxflip, weighted, search, mcts\n"
+        "  -n N   number of games, played in colour-swapped pairs (default 100)\n"
+        "  -j N   games played in parallel (default 1)\n"
+        "  -o N   random opening plies before the strategies take over (default 4)\n"
+        "  -m MS  per-move time for the search strategy (default 100)\n"
+        "  -c MS  game clock per side for the search strategy, instead of -m\n"
+        "  -i MS  clock increment per move\n"
+        "  -t N   threads per search (default 1)\n"
+        "  -s N   seed for openings and the random strategy (default 1)\n"
+        "  -b FILE opening book for the search strategy\n"
+        "  -r FILE write every game to a record file\n"
+        "  -d FILE solved-endgame database the search strategy reads and extends\n"
+        "  -x FILE write per-move search statistics as JSON lines\n"
+        "  -w FILE evaluation weights from othello_tune\n"
+        "  -e a|b|ab  sides that evaluate with the network instead of the patterns\n"
+        "  -N FILE network for -e, from nn_save (default: the built-in stand-in)\n");
+}
+
+int main(int argc, char** argv) {
+    static Thread threads[MAX_WORKERS];
+    Arena arena;
+    int workers = 1;
+    int named = 0;
+
+    memset(&arena, 0, sizeof(arena));
+    arena.games = 100;
+    arena.opening_plies = 4;
+    arena.seed = 1;
+    set_search_time(100);
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            const char* value = argv[++i];
+            switch (argv[i - 1][1]) {
+            case 'n': arena.games = atoi(value); break;
+            case 'j': workers = atoi(value); break;
+            case 'o': arena.opening_plies = atoi(value); break;
+            case 'm': set_search_time(atoi(value)); break;
+            case 'c': arena.clock_ms = atoi(value); break;
+            case 'i': arena.increment_ms = atoi(value); break;
+            case 't': set_search_threads(atoi(value)); break;
+            case 's': arena.seed = strtoull(value, NULL, 10); break;
+            case 'r':
+                if (!(arena.record = record_writer_open(value))) {
+                    fprintf(stderr, "cannot create %s\n", value);
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (!set_book(value)) {
+                    fprintf(stderr, "cannot open book %s\n", value);
+                    return 1;
+                }
+                break;
+            case 'w':
+                if (!set_weights(value)) {
+                    fprintf(stderr, "cannot load weights %s\n", value);
+                    return 1;
+                }
+                break;
+            case 'x':
+                if (!(arena.stats = fopen(value, "w"))) {
+                    fprintf(stderr, "cannot create %s\n", value);
+                    return 1;
+                }
+                break;
+            case 'd':
+                if (!set_solved_db(value)) {
+                    fprintf(stderr, "cannot open solved database %s\n", value);
+                    return 1;
+                }
+                break;
+            case 'e':
+                arena.evaluator[0] = strchr(value, 'a') ? EVAL_NETWORK : EVAL_PATTERNS;
+                arena.evaluator[1] = strchr(value, 'b') ? EVAL_NETWORK : EVAL_PATTERNS;
+                break;
+            case 'N':
+                if (!set_network(value)) {
+                    fprintf(stderr, "cannot load network %s\n", value);
+                    return 1;
+                }
+                break;
+            default: usage(); return 1;
+            }
+        }
+        else if (named < 2 && parse_strategy(argv[i], &arena.strategy[named])) {
+            named++;
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (named != 2) {
+        usage();
+        return 1;
+    }
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    // Shared tables are set up here, before any game can race to do it.
+    tt_ensure();
+    eval_init();
+    if (arena.evaluator[0] || arena.evaluator[1]) nn_init();
+
+    mutex_init(&arena.lock);
+    int64_t start = now_ms();
+    for (int i = 1; i < workers; i++)
+        if (!thread_start(&threads[i], worker_main, &arena)) workers = i;
+    worker_main(&arena);
+    for (int i = 1; i < workers; i++) thread_join(&threads[i]);
+    int64_t elapsed = now_ms() - start;
+    mutex_destroy(&arena.lock);
+    if (arena.record && !record_writer_close(arena.record)) fprintf(stderr, "error writing the game record\n");
+    if (arena.stats && fclose(arena.stats) != 0) fprintf(stderr, "error writing the statistics\n");
+
+    int played = arena.wins + arena.draws + arena.losses;
+    printf("%s%s vs %s%s: %d games\n", strategy_name(arena.strategy[0]), arena.evaluator[0] ? " (network)" : "",
+        strategy_name(arena.strategy[1]), arena.evaluator[1] ? " (network)" : "", played);
+    printf("win %d  draw %d  loss %d  (score %.1f%%)\n", arena.wins, arena.draws, arena.losses,
+        played ? 100.0 * (arena.wins + 0.5 * arena.draws) / played : 0.0);
+    printf("average disc difference %+.2f\n", played ? (double)arena.disc_diff / played : 0.0);
+    if (arena.clock_ms > 0) printf("clock overruns in %d games\n", arena.overruns);
+    printf("%.1f games/s (%.2f s)\n", elapsed > 0 ? played * 1000.0 / elapsed : 0.0, elapsed / 1000.0);
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <string.h>
+#include "batch.h"
+#include "bitboard.h"
+#include "board.h"
+#include "eval.h"
+#include "platform.h"
+#include "search.h"
+#include "tt.h"
+
+// Positions a worker takes at a time, and room for their children at depth 1.
+#define BATCH_BLOCK 256
+#define BATCH_CHILDREN (BATCH_BLOCK * BB_MAX_MOVES)
+
+typedef struct {
+    const PackedPosition* positions;
+    size_t count;
+    const BatchParams* params;
+    int* scores;
+    int* moves;
+
+    Mutex lock;
+    size_t next;            // first position no worker has taken yet
+    Thread thread[SEARCH_MAX_THREADS];
+} Batch;
+
+// Per-worker scratch space, in struct-of-arrays form for eval_batch. Too big for the stack.
+typedef struct {
+    uint64_t own[BATCH_CHILDREN];
+    uint64_t opp[BATCH_CHILDREN];
+    int score[BATCH_CHILDREN];
+    int parent[BATCH_CHILDREN];
+    int sq[BATCH_CHILDREN];
+} Scratch;
+
+static int final_score(uint64_t own, uint64_t opp) {
+    return diff_to_score(bb_count(own) - bb_count(opp));
+}
+
+static void static_block(const Batch* b, size_t first, int n, Scratch* w) {
+    for (int i = 0; i < n; i++) {
+        w->own[i] = b->positions[first + i].own;
+        w->opp[i] = b->positions[first + i].opp;
+    }
+    eval_batch(w->own, w->opp, n, b->scores + first);
+    if (b->moves)
+        for (int i = 0; i < n; i++) b->moves[first + i] = -1;
+}
+
+// One ply: every child of the block goes through eval_batch together, then each
+// position keeps its best child. Finished games score exactly.
+static void one_ply_block(const Batch* b, size_t first, int n, Scratch* w) {
+    int children = 0;
+
+    for (int i = 0; i < n; i++) {
+        uint64_t own = b->positions[first + i].own, opp = b->positions[first + i].opp;
+        uint64_t moves = bb_moves(own, opp);
+
+        b->scores[first + i] = -SCORE_INF;
+        if (b->moves) b->moves[first + i] = -1;
+        if (!moves) {
+            // A pass is scored statically from the mover's side; a finished game exactly.
+            b->scores[first + i] = bb_moves(opp, own) ? evaluate(&(Position){ own, opp, 0, BLACK }) : final_score(own, opp);
+            continue;
+        }
+        for (; moves; moves &= moves - 1) {
+            int sq = bb_first(moves);
+            uint64_t flipped = bb_flips(own, opp, sq);
+            w->own[children] = opp ^ flipped;
+            w->opp[children] = own | flipped | SQ_BIT(sq);
+            w->parent[children] = i;
+            w->sq[children] = sq;
+            children++;
+        }
+    }
+
+    eval_batch(w->own, w->opp, children, w->score);
+    for (int c = 0; c < children; c++) {
+        size_t k = first + (size_t)w->parent[c];
+        int score = -w->score[c];
+        if (!bb_moves(w->own[c], w->opp[c]) && !bb_moves(w->opp[c], w->own[c])) score = -final_score(w->own[c], w->opp[c]);
+        if (score > b->scores[k]) {
+            b->scores[k] = score;
+            if (b->moves) b->moves[k] = w->sq[c];
+        }
+    }
+}
+
+static void search_block(const Batch* b, size_t first, int n) {
+    SearchParams params;
+
+    search_params_init(&params);
+    params.time_ms = 0;
+    params.depth = b->params->depth;
+    params.endgame_empties = b->params->endgame_empties;
+    params.threads = 1;
+    for (int i = 0; i < n; i++) {
+        uint64_t own = b->positions[first + i].own, opp = b->positions[first + i].opp;
+        Position pos;
+        SearchResult result;
+        int sign = 1;
+
+        // The search wants a move at the root, so a pass is searched from the other side.
+        bb_set_position(&pos, own, opp, BLACK);
+        if (!bb_moves(own, opp)) {
+            if (!bb_moves(opp, own)) {
+                b->scores[first + i] = final_score(own, opp);
+                if (b->moves) b->moves[first + i] = -1;
+                continue;
+            }
+            bb_pass(&pos);
+            sign = -1;
+        }
+        search_best_move(&pos, &params, &result);
+        b->scores[first + i] = sign * result.score;
+        if (b->moves) b->moves[first + i] = sign > 0 ? result.move : -1;
+    }
+}
+
+static void worker_main(void* arg) {
+    Batch* b = arg;
+    Scratch* w = b->params->depth <= 1 ? aligned_malloc(sizeof(Scratch), 64) : NULL;
+
+    // Without scratch space this worker leaves the positions to the others.
+    if (b->params->depth <= 1 && !w) return;
+    for (;;) {
+        mutex_lock(&b->lock);
+        size_t first = b->next;
+        b->next += BATCH_BLOCK;
+        mutex_unlock(&b->lock);
+        if (first >= b->count) break;
+
+        int n = b->count - first < BATCH_BLOCK ? (int)(b->count - first) : BATCH_BLOCK;
+        if (b->params->depth <= 0) static_block(b, first, n, w);
+        else if (b->params->depth == 1) one_ply_block(b, first, n, w);
+        else search_block(b, first, n);
+    }
+    if (w) aligned_free(w);
+}
+
+void batch_params_init(BatchParams* params) {
+    params->depth = 1;
+    params->endgame_empties = 0;
+    params->threads = 1;
+}
+
+int batch_evaluate(const PackedPosition* positions, size_t count, const BatchParams* params, int* scores, int* moves) {
+    Batch b;
+    int threads = params->threads < 1 ? 1 : params->threads > SEARCH_MAX_THREADS ? SEARCH_MAX_THREADS : params->threads;
+
+    memset(&b, 0, sizeof(b));
+    b.positions = positions;
+    b.count = count;
+    b.params = params;
+    b.scores = scores;
+    b.moves = moves;
+
+    // Shared tables are set up here, before any worker can race to do it.
+    eval_init();
+    if (params->depth > 1) tt_ensure();
+
+    mutex_init(&b.lock);
+    for (int i = 1; i < threads; i++)
+        if (!thread_start(&b.thread[i], worker_main, &b)) threads = i;
+    worker_main(&b);
+    for (int i = 1; i < threads; i++) thread_join(&b.thread[i]);
+    mutex_destroy(&b.lock);
+    return b.next >= count;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A position as the batch API takes it: the discs of the side to move and of the other
+// side. 16 bytes, so millions of them fit comfortably in memory.
+typedef struct {
+    uint64_t own;
+    uint64_t opp;
+} PackedPosition;
+
+typedef struct {
+    int depth;              // 0 static score only, 1 best move by static score, more a fixed-depth search
+    int endgame_empties;    // searches solve exactly from this many empties; 0 never
+    int threads;
+} BatchParams;
+
+void batch_params_init(BatchParams* params);
+
+// Scores (search units, side to move) and best squares of count positions, spread over
+// params->threads threads. moves may be NULL; a move is -1 when the side to move has to
+// pass or depth is 0. Deeper searches share the transposition table. Returns 0 if no
+// worker could allocate its scratch space.
+int batch_evaluate(const PackedPosition* positions, size_t count, const BatchParams* params, int* scores, int* moves);
+
+#endif
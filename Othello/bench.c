@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "batch.h"
+#include "bitboard.h"
+#include "computer.h"
+#include "endgame.h"
+#include "eval.h"
+#include "mcts.h"
+#include "nn.h"
+#include "platform.h"
+#include "rng.h"
+#include "search.h"
+#include "symmetry.h"
+#include "tt.h"
+
+#define CORPUS_SIZE 1000
+#define CORPUS_SEED 20241014
+#define MIN_BENCH_MS 200
+#define PERFT_CHECK_DEPTH 9
+#define ORDERING_DEPTH 8
+#define ENDGAME_EMPTIES 16
+
+// Leaf counts from the start position, passes counted as plies.
+static const uint64_t perft_expected[] = {
+    1, 4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284, 212258800
+};
+
+typedef struct {
+    int board[8][8];
+    int color;
+    Position pos;
+} Sample;
+
+static Sample corpus[CORPUS_SIZE];
+static volatile uint64_t sink;
+
+// Random games from a fixed seed, sampled at every ply, so the corpus is the same on every run.
+static void build_corpus(void) {
+    Rng rng;
+    int n = 0;
+    rng_seed(&rng, CORPUS_SEED);
+
+    while (n < CORPUS_SIZE) {
+        int board[8][8];
+        int color = BLACK;
+        init_board(board);
+
+        while (n < CORPUS_SIZE && !is_game_over(board)) {
+            int moves[60][2];
+            int count = generate_move_list(board, color, moves);
+            if (count > 0) {
+                int i = (int)rng_below(&rng, (uint32_t)count);
+                memcpy(corpus[n].board, board, sizeof(board));
+                corpus[n].color = color;
+                bb_from_board(board, color, &corpus[n].pos);
+                n++;
+                apply_move(board, moves[i][0], moves[i][1], color);
+            }
+            color = -color;
+        }
+    }
+}
+
+static void report(const char* name, uint64_t ops, int64_t ms) {
+    printf("%-28s %10.1f ns/op %12llu ops\n", name, ms * 1e6 / (double)ops, (unsigned long long)ops);
+}
+
+// Repeats one pass over the corpus until MIN_BENCH_MS has elapsed.
+#define BENCH(name, ops_per_sample, ...)                                    \
+    do {                                                                    \
+        uint64_t ops = 0, acc = 0;                                          \
+        int64_t start = now_ms(), elapsed;                                  \
+        do {                                                                \
+            for (int k = 0; k < CORPUS_SIZE; k++) {                         \
+                Sample* s = &corpus[k];                                     \
+                __VA_ARGS__;                                                \
+            }                                                               \
+            ops += (uint64_t)CORPUS_SIZE * (ops_per_sample);                \
+        } while ((elapsed = now_ms() - start) < MIN_BENCH_MS);              \
+        sink += acc;                                                        \
+        report(name, ops, elapsed);                                         \
+    } while (0)
+
+static void bench_primitives(void) {
+    BENCH("is_valid_move", 64,
+        for (int sq = 0; sq < 64; sq++) acc += is_valid_move(s->board, sq / 8, sq % 8, s->color));
+    BENCH("count_flippable", 64,
+        for (int sq = 0; sq < 64; sq++) acc += count_flippable(s->board, sq / 8, sq % 8, s->color));
+    BENCH("has_valid_move", 1, acc += has_valid_move(s->board, s->color));
+    BENCH("generate_moves", 1, acc += generate_moves(s->board, s->color));
+    BENCH("place_disc", 1, {
+        int board[8][8];
+        uint64_t moves = bb_moves(s->pos.own, s->pos.opp);
+        memcpy(board, s->board, sizeof(board));
+        if (moves) place_disc(board, bb_first(moves) / 8, bb_first(moves) % 8, s->color);
+        acc += board[3][3];
+    });
+    BENCH("bb_moves", 1, acc += bb_moves(s->pos.own, s->pos.opp));
+    BENCH("bb_flips scalar", 64,
+        for (int sq = 0; sq < 64; sq++) acc += bb_flips_scalar(s->pos.own, s->pos.opp, sq));
+    if (bb_has_avx2())
+        BENCH("bb_flips avx2", 64,
+            for (int sq = 0; sq < 64; sq++) acc += bb_flips_avx2(s->pos.own, s->pos.opp, sq));
+    BENCH("evaluate", 1, acc += (uint64_t)evaluate(&s->pos));
+    BENCH("bb_canonical_key", 1, acc += bb_canonical_key(&s->pos, NULL));
+    BENCH("bb_make_move+undo", 1, {
+        uint64_t moves = bb_moves(s->pos.own, s->pos.opp);
+        if (moves) {
+            Undo undo;
+            bb_make_move(&s->pos, bb_first(moves), &undo);
+            acc += s->pos.own;
+            bb_undo_move(&s->pos, &undo);
+        }
+    });
+}
+
+static void bench_strategies(int search_ms) {
+    static const Strategy greedy[] = { RANDOM, MAX_FLIP, WEIGHTED };
+    ComputerContext ctx;
+    computer_init(&ctx, CORPUS_SEED);
+
+    for (int i = 0; i < 3; i++) {
+        SearchLimits limits;
+        char name[64];
+        search_limits_init(&limits, greedy[i]);
+        snprintf(name, sizeof(name), "get_computer_move %s", strategy_name(greedy[i]));
+        BENCH(name, 1, {
+            int row, col;
+            get_computer_move(&ctx, s->board, s->color, &row, &col, &limits);
+            acc += (uint64_t)row;
+        });
+    }
+
+    // Full searches are too slow for the whole corpus; every 50th sample is used.
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        SearchParams params;
+        uint64_t nodes = 0;
+        int64_t ms = 0;
+
+        search_params_init(&params);
+        params.time_ms = search_ms;
+        params.endgame_empties = 0;
+        params.threads = threads;
+        for (int k = 0; k < CORPUS_SIZE; k += 50) {
+            SearchResult result;
+            search_best_move(&corpus[k].pos, &params, &result);
+            nodes += result.nodes;
+            ms += result.time_ms;
+        }
+        printf("search %d thread%s %23.0f nodes/s %12llu nodes\n", threads, threads > 1 ? "s" : " ",
+            ms > 0 ? nodes * 1000.0 / ms : 0.0, (unsigned long long)nodes);
+    }
+
+    // MCTS on the same positions, a fresh tree for each, with playouts and then the network.
+    for (int network = 0; network <= 1; network++) {
+        for (int threads = 1; threads <= 8; threads *= 2) {
+            MctsParams params;
+            uint64_t playouts = 0;
+            int64_t ms = 0;
+
+            params.time_ms = search_ms;
+            params.playouts = 0;
+            params.stop = NULL;
+            params.threads = threads;
+            params.memory_mb = MCTS_DEFAULT_MB;
+            params.seed = CORPUS_SEED;
+            params.evaluator = network ? EVAL_NETWORK : EVAL_PATTERNS;
+            for (int k = 0; k < CORPUS_SIZE; k += 50) {
+                MctsTree tree;
+                MctsResult result;
+                mcts_init(&tree);
+                mcts_search(&tree, &corpus[k].pos, &params, &result);
+                mcts_free(&tree);
+                playouts += result.playouts;
+                ms += result.time_ms;
+            }
+            printf("mcts %-7s %d thread%s %17.0f playouts/s %9llu playouts\n", network ? "network" : "playout",
+                threads, threads > 1 ? "s" : " ", ms > 0 ? playouts * 1000.0 / ms : 0.0, (unsigned long long)playouts);
+        }
+    }
+    computer_free(&ctx);
+}
+
+// The batch API over the whole corpus at once, per position.
+static void bench_batch(void) {
+    static PackedPosition packed[CORPUS_SIZE];
+    static int scores[CORPUS_SIZE], moves[CORPUS_SIZE];
+
+    for (int k = 0; k < CORPUS_SIZE; k++) {
+        packed[k].own = corpus[k].pos.own;
+        packed[k].opp = corpus[k].pos.opp;
+    }
+    for (int depth = 0; depth <= 1; depth++) {
+        BatchParams params;
+        char name[64];
+        uint64_t ops = 0;
+        int64_t start = now_ms(), elapsed;
+
+        batch_params_init(&params);
+        params.depth = depth;
+        do {
+            batch_evaluate(packed, CORPUS_SIZE, &params, scores, moves);
+            ops += CORPUS_SIZE;
+        } while ((elapsed = now_ms() - start) < MIN_BENCH_MS);
+        sink += (uint64_t)scores[0];
+        snprintf(name, sizeof(name), "batch_evaluate depth %d", depth);
+        report(name, ops, elapsed);
+    }
+}
+
+// The network one position at a time, in batches over the corpus with each kernel, and
+// through a queue with one thread, the overhead MCTS pays per leaf. Non-zero if the
+// kernels disagree anywhere.
+static int bench_network(void) {
+    static uint64_t own[CORPUS_SIZE], opp[CORPUS_SIZE];
+    static int scalar[CORPUS_SIZE], fast[CORPUS_SIZE];
+    static NnRequest requests[64];
+    NnQueue queue;
+    int mismatches = 0, n;
+
+    for (int k = 0; k < CORPUS_SIZE; k++) {
+        own[k] = corpus[k].pos.own;
+        opp[k] = corpus[k].pos.opp;
+    }
+    nn_evaluate_batch_scalar(own, opp, CORPUS_SIZE, scalar);
+    nn_evaluate_batch(own, opp, CORPUS_SIZE, fast);
+    for (int k = 0; k < CORPUS_SIZE; k++) mismatches += scalar[k] != fast[k];
+    printf("nn kernels %s\n", mismatches ? "MISMATCH" : "ok");
+
+    BENCH("nn_evaluate", 1, acc += (uint64_t)nn_evaluate(s->pos.own, s->pos.opp));
+    for (int kernel = 0; kernel <= 1; kernel++) {
+        uint64_t ops = 0;
+        int64_t start = now_ms(), elapsed;
+        do {
+            if (kernel) nn_evaluate_batch(own, opp, CORPUS_SIZE, fast);
+            else nn_evaluate_batch_scalar(own, opp, CORPUS_SIZE, scalar);
+            ops += CORPUS_SIZE;
+        } while ((elapsed = now_ms() - start) < MIN_BENCH_MS);
+        report(kernel ? "nn_evaluate_batch" : "nn_evaluate_batch scalar", ops, elapsed);
+    }
+    nn_queue_init(&queue, 64);
+    n = 0;
+    BENCH("nn_queue submit+wait", 1, {
+        requests[n].own = s->pos.own;
+        requests[n].opp = s->pos.opp;
+        nn_queue_submit(&queue, &requests[n++]);
+        if (n == 64) {
+            for (int i = 0; i < n; i++) acc += (uint64_t)nn_queue_wait(&queue, &requests[i]);
+            n = 0;
+        }
+    });
+    for (int i = 0; i < n; i++) sink += (uint64_t)nn_queue_wait(&queue, &requests[i]);
+    nn_queue_destroy(&queue);
+    return mismatches != 0;
+}
+
+// A position with 35 legal moves, more than the search's lists once had room for, through
+// the batch API at depth 1 and 3 against evaluating its children and a direct search.
+// Non-zero on a mismatch.
+static int check_wide_batch(void) {
+    static const PackedPosition wide = { 0x0108302400661800ULL, 0x02504e4a42106600ULL };
+    int failed = 0;
+
+    for (int depth = 1; depth <= 3; depth += 2) {
+        BatchParams params;
+        int score, move, expected = -SCORE_INF, expected_move = -1;
+
+        batch_params_init(&params);
+        params.depth = depth;
+        tt_clear();
+        batch_evaluate(&wide, 1, &params, &score, &move);
+        if (depth == 1) {
+            for (uint64_t moves = bb_moves(wide.own, wide.opp); moves; moves &= moves - 1) {
+                int sq = bb_first(moves);
+                uint64_t flipped = bb_flips(wide.own, wide.opp, sq);
+                int child = -evaluate(&(Position){ wide.opp ^ flipped, wide.own | flipped | SQ_BIT(sq), 0, BLACK });
+                if (child > expected) {
+                    expected = child;
+                    expected_move = sq;
+                }
+            }
+        }
+        else {
+            SearchParams search;
+            SearchResult result;
+            Position pos;
+            search_params_init(&search);
+            search.time_ms = 0;
+            search.depth = depth;
+            search.endgame_empties = 0;
+            bb_set_position(&pos, wide.own, wide.opp, BLACK);
+            tt_clear();
+            search_best_move(&pos, &search, &result);
+            expected = result.score;
+            expected_move = result.move;
+        }
+        int ok = score == expected && move == expected_move;
+        printf("batch %d moves depth %d %s\n", bb_count(bb_moves(wide.own, wide.opp)), depth, ok ? "ok" : "MISMATCH");
+        failed |= !ok;
+    }
+    return failed;
+}
+
+// Nodes to a fixed depth with and without move ordering, each search from an empty table.
+static void bench_ordering(int depth) {
+    for (int ordering = 1; ordering >= 0; ordering--) {
+        SearchParams params;
+        uint64_t nodes = 0;
+        int64_t ms = 0;
+
+        search_params_init(&params);
+        params.time_ms = 0;
+        params.depth = depth;
+        params.endgame_empties = 0;
+        params.ordering = ordering;
+        for (int k = 0; k < CORPUS_SIZE; k += 50) {
+            SearchResult result;
+            tt_clear();
+            search_best_move(&corpus[k].pos, &params, &result);
+            nodes += result.nodes;
+            ms += result.time_ms;
+        }
+        printf("depth %d ordering %-3s %22llu nodes %10.2f s\n", depth, ordering ? "on" : "off",
+            (unsigned long long)nodes, ms / 1000.0);
+    }
+}
+
+// Nodes to a fixed depth for the best k moves from one search, against k = 1, which is
+// about what each of k separate searches with moves left out would cost.
+static void bench_analysis(int depth, int k) {
+    SearchParams params;
+    uint64_t nodes[2] = { 0, 0 };
+
+    search_params_init(&params);
+    params.time_ms = 0;
+    params.depth = depth;
+    params.endgame_empties = 0;
+    for (int i = 0; i < 2; i++) {
+        for (int c = 0; c < CORPUS_SIZE; c += 50) {
+            SearchLine lines[SEARCH_MAX_LINES];
+            SearchResult result;
+            tt_clear();
+            search_analyze(&corpus[c].pos, &params, i ? k : 1, lines, &result);
+            nodes[i] += result.nodes;
+        }
+    }
+    printf("depth %d, %d lines %26llu nodes %10.2fx one line\n", depth, k, (unsigned long long)nodes[1],
+        nodes[0] ? (double)nodes[1] / (double)nodes[0] : 0.0);
+}
+
+// Exact solves of every corpus position with this many empties, each from an empty table.
+// A fixed amount of work, so nodes/s compares builds.
+static void bench_endgame(int empties) {
+    uint64_t nodes = 0;
+    int64_t start = now_ms();
+    int solved = 0;
+
+    for (int k = 0; k < CORPUS_SIZE; k++) {
+        EndgameResult result;
+        if (64 - bb_count(corpus[k].pos.own | corpus[k].pos.opp) != empties) continue;
+        tt_clear();
+        endgame_solve(&corpus[k].pos, INT64_MAX / 2, 0, NULL, &result);
+        sink += (uint64_t)result.score;
+        nodes += result.nodes;
+        solved++;
+    }
+    int64_t ms = now_ms() - start;
+    printf("endgame %d empties, %d solves %12.0f nodes/s %12llu nodes %10.2f s\n", empties, solved,
+        ms > 0 ? nodes * 1000.0 / ms : 0.0, (unsigned long long)nodes, ms / 1000.0);
+}
+
+// Perft through the int[8][8] API, the slow path main.c and player.c use.
+static uint64_t board_perft(int board[8][8], int color, int depth) {
+    int moves[60][2];
+    int count = generate_move_list(board, color, moves);
+    uint64_t nodes = 0;
+
+    if (depth == 0) return 1;
+    if (count == 0) {
+        if (!has_valid_move(board, -color)) return 1;
+        return board_perft(board, -color, depth - 1);
+    }
+    for (int i = 0; i < count; i++) {
+        Undo undo = apply_move(board, moves[i][0], moves[i][1], color);
+        nodes += board_perft(board, -color, depth - 1);
+        undo_move(board, &undo);
+    }
+    return nodes;
+}
+
+static int check_perft(void) {
+    int board[8][8];
+    Position pos;
+    int failed = 0;
+
+    init_board(board);
+    bb_from_board(board, BLACK, &pos);
+    for (int depth = 1; depth <= PERFT_CHECK_DEPTH; depth++) {
+        int64_t start = now_ms();
+        uint64_t nodes = bb_perft(&pos, depth);
+        int64_t elapsed = now_ms() - start;
+        uint64_t slow = depth <= 7 ? board_perft(board, BLACK, depth) : nodes;
+        int ok = nodes == perft_expected[depth] && slow == nodes;
+
+        printf("perft %2d %12llu %s", depth, (unsigned long long)nodes, ok ? "ok" : "MISMATCH");
+        if (elapsed > 0) printf("  %.0f nodes/s", nodes * 1000.0 / elapsed);
+        printf("\n");
+        failed |= !ok;
+    }
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    int search_ms = argc > 1 ? atoi(argv[1]) : 100;
+
+    build_corpus();
+    int failed = check_perft();
+    bench_primitives();
+    bench_batch();
+    failed |= check_wide_batch();
+    failed |= bench_network();
+    bench_strategies(search_ms);
+    bench_ordering(ORDERING_DEPTH);
+    bench_analysis(8, 4);
+    bench_endgame(ENDGAME_EMPTIES);
+    return failed;
+}
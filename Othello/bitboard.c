@@ -0,0 +1,230 @@
+#include "board.h"
+#include "bitboard.h"
+#include "platform.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BB_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define BB_AVX2 0
+#endif
+
+// Opponent mask for shifts that move along a row: keeps runs off columns 0 and 7.
+#define NOT_EDGE_COLS 0x7e7e7e7e7e7e7e7eULL
+
+static inline uint64_t shift(uint64_t b, int s) {
+    return s > 0 ? b << s : b >> -s;
+}
+
+uint64_t bb_hash(uint64_t own, uint64_t opp, int color) {
+    uint64_t black = color == BLACK ? own : opp;
+    uint64_t white = color == BLACK ? opp : own;
+    uint64_t h = color == BLACK ? 0 : zobrist_side;
+
+    for (; black; black &= black - 1) h ^= zobrist_disc[0][bb_first(black)];
+    for (; white; white &= white - 1) h ^= zobrist_disc[1][bb_first(white)];
+    return h;
+}
+
+void bb_set_position(Position* pos, uint64_t own, uint64_t opp, int color) {
+    pos->own = own;
+    pos->opp = opp;
+    pos->color = color;
+    pos->hash = bb_hash(own, opp, color);
+}
+
+void bb_board_masks(int board[8][8], int color, uint64_t* own, uint64_t* opp) {
+    *own = 0;
+    *opp = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (board[i][j] == color) *own |= SQ_BIT(SQ(i, j));
+            else if (board[i][j] == -color) *opp |= SQ_BIT(SQ(i, j));
+        }
+    }
+}
+
+void bb_from_board(int board[8][8], int color, Position* pos) {
+    uint64_t own, opp;
+    bb_board_masks(board, color, &own, &opp);
+    bb_set_position(pos, own, opp, color);
+}
+
+void bb_to_board(const Position* pos, int board[8][8]) {
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            uint64_t bit = SQ_BIT(SQ(i, j));
+            if (pos->own & bit) board[i][j] = pos->color;
+            else if (pos->opp & bit) board[i][j] = -pos->color;
+            else board[i][j] = EMPTY;
+        }
+    }
+}
+
+static inline uint64_t moves_dir(uint64_t own, uint64_t opp, int s) {
+    uint64_t t = opp & shift(own, s);
+    t |= opp & shift(t, s);
+    t |= opp & shift(t, s);
+    t |= opp & shift(t, s);
+    t |= opp & shift(t, s);
+    t |= opp & shift(t, s);
+    return shift(t, s);
+}
+
+uint64_t bb_moves(uint64_t own, uint64_t opp) {
+    uint64_t inner = opp & NOT_EDGE_COLS;
+    uint64_t moves = moves_dir(own, inner, 1) | moves_dir(own, inner, -1)
+        | moves_dir(own, opp, 8) | moves_dir(own, opp, -8)
+        | moves_dir(own, inner, 7) | moves_dir(own, inner, -7)
+        | moves_dir(own, inner, 9) | moves_dir(own, inner, -9);
+    return moves & ~(own | opp);
+}
+
+uint64_t bb_neighbors(uint64_t b) {
+    // Discs that may step towards column 0 / column 7 without wrapping.
+    uint64_t left = b & 0xfefefefefefefefeULL, right = b & 0x7f7f7f7f7f7f7f7fULL;
+    return (b << 8) | (b >> 8)
+        | (right << 1) | (right << 9) | (right >> 7)
+        | (left >> 1) | (left >> 9) | (left << 7);
+}
+
+static inline uint64_t flips_dir(uint64_t own, uint64_t opp, uint64_t x, int s) {
+    uint64_t f = opp & shift(x, s);
+    f |= opp & shift(f, s);
+    f |= opp & shift(f, s);
+    f |= opp & shift(f, s);
+    f |= opp & shift(f, s);
+    f |= opp & shift(f, s);
+    // The run only flips if it is closed by an own disc; masked rather than branched on.
+    return f & (0 - (uint64_t)((shift(f, s) & own) != 0));
+}
+
+uint64_t bb_flips_scalar(uint64_t own, uint64_t opp, int sq) {
+    uint64_t x = SQ_BIT(sq);
+    uint64_t inner = opp & NOT_EDGE_COLS;
+    return flips_dir(own, inner, x, 1) | flips_dir(own, inner, x, -1)
+        | flips_dir(own, opp, x, 8) | flips_dir(own, opp, x, -8)
+        | flips_dir(own, inner, x, 7) | flips_dir(own, inner, x, -7)
+        | flips_dir(own, inner, x, 9) | flips_dir(own, inner, x, -9);
+}
+
+#if BB_AVX2
+// Directions 1, 8, 7, 9 in the four lanes: one pass shifting up, one shifting down.
+TARGET_AVX2 uint64_t bb_flips_avx2(uint64_t own, uint64_t opp, int sq) {
+    const __m256i shifts = _mm256_set_epi64x(9, 7, 8, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t inner = opp & NOT_EDGE_COLS;
+    __m256i o = _mm256_set1_epi64x((long long)own);
+    __m256i mask = _mm256_set_epi64x((long long)inner, (long long)inner, (long long)opp, (long long)inner);
+    __m256i x = _mm256_set1_epi64x((long long)SQ_BIT(sq));
+
+    __m256i up = _mm256_and_si256(mask, _mm256_sllv_epi64(x, shifts));
+    __m256i down = _mm256_and_si256(mask, _mm256_srlv_epi64(x, shifts));
+    for (int i = 0; i < 5; i++) {
+        up = _mm256_or_si256(up, _mm256_and_si256(mask, _mm256_sllv_epi64(up, shifts)));
+        down = _mm256_or_si256(down, _mm256_and_si256(mask, _mm256_srlv_epi64(down, shifts)));
+    }
+    // Keep a lane only where the run is closed by an own disc.
+    __m256i up_open = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_sllv_epi64(up, shifts), o), zero);
+    __m256i down_open = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_srlv_epi64(down, shifts), o), zero);
+    __m256i f = _mm256_or_si256(_mm256_andnot_si256(up_open, up), _mm256_andnot_si256(down_open, down));
+
+    __m128i h = _mm_or_si128(_mm256_castsi256_si128(f), _mm256_extracti128_si256(f, 1));
+    return (uint64_t)_mm_cvtsi128_si64(_mm_or_si128(h, _mm_unpackhi_epi64(h, h)));
+}
+
+int bb_has_avx2(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, and the OS saves the YMM registers.
+    if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28) || (_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#else
+uint64_t bb_flips_avx2(uint64_t own, uint64_t opp, int sq) {
+    return bb_flips_scalar(own, opp, sq);
+}
+
+int bb_has_avx2(void) {
+    return 0;
+}
+#endif
+
+static uint64_t (*flips_kernel)(uint64_t own, uint64_t opp, int sq);
+static Once flips_once = ONCE_INIT;
+
+static void pick_flips(void) {
+    flips_kernel = bb_has_avx2() ? bb_flips_avx2 : bb_flips_scalar;
+}
+
+// The first call picks the kernel for this CPU; the kernel is only read once that is done.
+uint64_t bb_flips(uint64_t own, uint64_t opp, int sq) {
+    run_once(&flips_once, pick_flips);
+    return flips_kernel(own, opp, sq);
+}
+
+uint64_t bb_perft(Position* pos, int depth) {
+    uint64_t moves = bb_moves(pos->own, pos->opp);
+    uint64_t nodes = 0;
+
+    if (!moves) {
+        // Game over is a leaf; a pass uses up a ply, as a skipped turn does in main.c.
+        if (!bb_moves(pos->opp, pos->own)) return 1;
+        if (depth == 1) return 1;
+        bb_pass(pos);
+        nodes = bb_perft(pos, depth - 1);
+        bb_pass(pos);
+        return nodes;
+    }
+    if (depth == 1) return (uint64_t)bb_count(moves);
+
+    for (; moves; moves &= moves - 1) {
+        Undo undo;
+        bb_make_move(pos, bb_first(moves), &undo);
+        nodes += bb_perft(pos, depth - 1);
+        bb_undo_move(pos, &undo);
+    }
+    return nodes;
+}
+
+int bb_parse(const char* text, Position* pos) {
+    uint64_t black = 0, white = 0;
+    int sq = 0;
+
+    for (; *text && sq < 64; text++) {
+        if (*text == 'X' || *text == 'x' || *text == '*') black |= SQ_BIT(sq++);
+        else if (*text == 'O' || *text == 'o') white |= SQ_BIT(sq++);
+        else if (*text == '-' || *text == '.') sq++;
+        else if (*text != ' ' && *text != '\n' && *text != '\r' && *text != '\t') return 0;
+    }
+    if (sq != 64) return 0;
+
+    while (*text == ' ' || *text == '\t') text++;
+    int color = (*text == 'O' || *text == 'o') ? WHITE : BLACK;
+    bb_set_position(pos, color == BLACK ? black : white, color == BLACK ? white : black, color);
+    return 1;
+}
+
+void bb_format(const Position* pos, char out[67]) {
+    uint64_t black = pos->color == BLACK ? pos->own : pos->opp;
+    uint64_t white = pos->color == BLACK ? pos->opp : pos->own;
+
+    for (int sq = 0; sq < 64; sq++)
+        out[sq] = (black & SQ_BIT(sq)) ? 'X' : (white & SQ_BIT(sq)) ? 'O' : '-';
+    out[64] = ' ';
+    out[65] = pos->color == BLACK ? 'X' : 'O';
+    out[66] = '\0';
+}
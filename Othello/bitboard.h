@@ -0,0 +1,114 @@
+#pragma once
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#include "zobrist.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Square index: row * 8 + col, bit (1ULL << sq).
+#define SQ(row, col) ((row) * 8 + (col))
+#define SQ_BIT(sq) (1ULL << (sq))
+
+// Room for the legal moves of any position, however it was reached: every move is to an
+// empty square. Reachable positions can have 33.
+#define BB_MAX_MOVES 64
+
+// Position seen from the side to move: own = discs of the mover, color = its colour.
+// hash is the Zobrist key, kept up to date by make/undo/pass.
+typedef struct {
+    uint64_t own;
+    uint64_t opp;
+    uint64_t hash;
+    int color;
+} Position;
+
+// What a move changed, enough to take it back.
+typedef struct {
+    int sq;
+    uint64_t flipped;
+} Undo;
+
+static inline int bb_count(uint64_t b) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(b);
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+// Index of the lowest set bit; b must be non-zero.
+static inline int bb_first(uint64_t b) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, b);
+    return (int)index;
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+uint64_t bb_moves(uint64_t own, uint64_t opp);
+// Discs flipped by playing sq. Calls the AVX2 kernel when the CPU has it and the
+// portable one otherwise; both are branch-free and give the same result.
+uint64_t bb_flips(uint64_t own, uint64_t opp, int sq);
+uint64_t bb_flips_scalar(uint64_t own, uint64_t opp, int sq);
+uint64_t bb_flips_avx2(uint64_t own, uint64_t opp, int sq);     // only on a CPU with AVX2
+int bb_has_avx2(void);
+// Squares adjacent to any square of b, in all eight directions.
+uint64_t bb_neighbors(uint64_t b);
+
+static inline uint64_t bb_flip_hash(uint64_t flipped) {
+    uint64_t h = 0;
+    while (flipped) {
+        int sq = bb_first(flipped);
+        h ^= zobrist_disc[0][sq] ^ zobrist_disc[1][sq];
+        flipped &= flipped - 1;
+    }
+    return h;
+}
+
+// Plays sq for the side to move; the opponent is to move afterwards.
+static inline void bb_make_move(Position* pos, int sq, Undo* undo) {
+    uint64_t flipped = bb_flips(pos->own, pos->opp, sq);
+    uint64_t own = pos->own | flipped | SQ_BIT(sq);
+    undo->sq = sq;
+    undo->flipped = flipped;
+    pos->own = pos->opp ^ flipped;
+    pos->opp = own;
+    pos->hash ^= zobrist_disc[ZOBRIST_INDEX(pos->color)][sq] ^ bb_flip_hash(flipped) ^ zobrist_side;
+    pos->color = -pos->color;
+}
+
+static inline void bb_undo_move(Position* pos, const Undo* undo) {
+    uint64_t own = pos->opp ^ (undo->flipped | SQ_BIT(undo->sq));
+    pos->opp = pos->own | undo->flipped;
+    pos->own = own;
+    pos->color = -pos->color;
+    pos->hash ^= zobrist_disc[ZOBRIST_INDEX(pos->color)][undo->sq] ^ bb_flip_hash(undo->flipped) ^ zobrist_side;
+}
+
+static inline void bb_pass(Position* pos) {
+    uint64_t own = pos->own;
+    pos->own = pos->opp;
+    pos->opp = own;
+    pos->hash ^= zobrist_side;
+    pos->color = -pos->color;
+}
+
+uint64_t bb_hash(uint64_t own, uint64_t opp, int color);
+void bb_set_position(Position* pos, uint64_t own, uint64_t opp, int color);
+void bb_board_masks(int board[8][8], int color, uint64_t* own, uint64_t* opp);
+void bb_from_board(int board[8][8], int color, Position* pos);
+void bb_to_board(const Position* pos, int board[8][8]);
+// Text form: 64 squares row by row ('X' black, 'O' white, '-' empty), a space, then the side
+// to move ('X' or 'O'). bb_parse also accepts '.' for empty and defaults to black to move.
+int bb_parse(const char* text, Position* pos);
+void bb_format(const Position* pos, char out[67]);
+// Number of leaf positions depth plies below pos (depth >= 1); passes count as plies.
+uint64_t bb_perft(Position* pos, int depth);
+
+#endif
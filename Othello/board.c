@@ -1,11 +1,6 @@
 #include <stdio.h>
 #include "board.h"
-
-static const int dir[8][2] = {
-    {-1, -1}, {-1, 0}, {-1, 1}, 
-    { 0, -1}, { 0, 1}, 
-    { 1, -1}, { 1, 0}, { 1, 1}
-};
+#include "bitboard.h"
 
 void init_board(int board[8][8]) {
     for (int i = 0; i < 8; i++)
@@ -37,98 +32,83 @@ void print_board(int board[8][8]) {
 int is_valid_move(int board[8][8], int row, int col, int color) {
     if (board[row][col] != EMPTY) return 0;
 
-    for (int d = 0; d < 8; d++) {
-        int x = row + dir[d][0];
-        int y = col + dir[d][1];
-        int found_opponent = 0;
-
-        while (x >= 0 && x < 8 && y >= 0 && y < 8) {
-            if (board[x][y] == -color) {
-                found_opponent = 1;
-            }
-            else if (board[x][y] == color && found_opponent) {
-                return 1;
-            }
-            else {
-                break;
-            }
-            x += dir[d][0];
-            y += dir[d][1];
-        }
-    }
-    return 0;
+    uint64_t own, opp;
+    bb_board_masks(board, color, &own, &opp);
+    return bb_flips(own, opp, SQ(row, col)) != 0;
 }
 
-int has_valid_move(int board[8][8], int color) {
-    for (int i = 0; i < 8; i++)
-        for (int j = 0; j < 8; j++)
-            if (is_valid_move(board, i, j, color))
-                return 1;
-    return 0;
+uint64_t generate_moves(int board[8][8], int color) {
+    uint64_t own, opp;
+    bb_board_masks(board, color, &own, &opp);
+    return bb_moves(own, opp);
 }
 
-void place_disc(int board[8][8], int row, int col, int color) {
-    board[row][col] = color;
+int generate_move_list(int board[8][8], int color, int moves[60][2]) {
+    uint64_t mask = generate_moves(board, color);
+    int count = 0;
 
-    for (int d = 0; d < 8; d++) {
-        int x = row + dir[d][0];
-        int y = col + dir[d][1];
-        int to_flip[8][2], flip_count = 0;
-
-        while (x >= 0 && x < 8 && y >= 0 && y < 8 && board[x][y] == -color) {
-            to_flip[flip_count][0] = x;
-            to_flip[flip_count][1] = y;
-            flip_count++;
-            x += dir[d][0];
-            y += dir[d][1];
-        }
+    while (mask) {
+        int sq = bb_first(mask);
+        moves[count][0] = sq / 8;
+        moves[count][1] = sq % 8;
+        count++;
+        mask &= mask - 1;
+    }
+    return count;
+}
 
-        if (x >= 0 && x < 8 && y >= 0 && y < 8 && board[x][y] == color) {
-            for (int i = 0; i < flip_count; i++)
-                board[to_flip[i][0]][to_flip[i][1]] = color;
-        }
+int has_valid_move(int board[8][8], int color) {
+    return generate_moves(board, color) != 0;
+}
+
+static void set_discs(int board[8][8], uint64_t mask, int color) {
+    while (mask) {
+        int sq = bb_first(mask);
+        board[sq / 8][sq % 8] = color;
+        mask &= mask - 1;
     }
 }
 
+void place_disc(int board[8][8], int row, int col, int color) {
+    apply_move(board, row, col, color);
+}
+
 int is_game_over(int board[8][8]) {
-    return !has_valid_move(board, BLACK) && !has_valid_move(board, WHITE);
+    uint64_t own, opp;
+    bb_board_masks(board, BLACK, &own, &opp);
+    return !bb_moves(own, opp) && !bb_moves(opp, own);
 }
 
 int count_discs(int board[8][8], int color) {
-    int count = 0;
-    for (int i = 0; i < 8; i++)
-        for (int j = 0; j < 8; j++)
-            if (board[i][j] == color)
-                count++;
-    return count;
+    uint64_t own, opp;
+    bb_board_masks(board, color, &own, &opp);
+    return bb_count(own);
 }
 
 int count_flippable(int board[8][8], int row, int col, int color) {
     if (board[row][col] != EMPTY) return 0;
 
-    int flip_count = 0;
-
-    for (int d = 0; d < 8; d++) {
-        int x = row + dir[d][0];
-        int y = col + dir[d][1];
-        int count = 0;
+    uint64_t own, opp;
+    bb_board_masks(board, color, &own, &opp);
+    return bb_count(bb_flips(own, opp, SQ(row, col)));
+}
 
-        while (x >= 0 && x < 8 && y >= 0 && y < 8 && board[x][y] == -color) {
-            count++;
-            x += dir[d][0];
-            y += dir[d][1];
-        }
+Undo apply_move(int board[8][8], int row, int col, int color) {
+    uint64_t own, opp;
+    Undo undo;
+    bb_board_masks(board, color, &own, &opp);
 
-        if (count > 0 && x >= 0 && x < 8 && y >= 0 && y < 8 && board[x][y] == color) {
-            flip_count += count;
-        }
-    }
-
-    return flip_count;
+    undo.sq = SQ(row, col);
+    undo.flipped = bb_flips(own, opp, undo.sq);
+    board[row][col] = color;
+    set_discs(board, undo.flipped, color);
+    return undo;
 }
 
-void apply_move(int board[8][8], int row, int col, int color) {
-    place_disc(board, row, col, color);
+void undo_move(int board[8][8], const Undo* undo) {
+    int color = board[undo->sq / 8][undo->sq % 8];
+    board[undo->sq / 8][undo->sq % 8] = EMPTY;
+    set_discs(board, undo->flipped, -color);
 }
 
 int count_stones(int board[8][8], int color) {
@@ -2,6 +2,9 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <stdint.h>
+#include "bitboard.h"
+
 #define BLACK 1
 #define WHITE -1
 #define EMPTY 0
@@ -9,12 +12,15 @@
 void init_board(int board[8][8]);
 void print_board(int board[8][8]);
 int is_valid_move(int board[8][8], int row, int col, int color);
+uint64_t generate_moves(int board[8][8], int color);
+int generate_move_list(int board[8][8], int color, int moves[60][2]);
 int has_valid_move(int board[8][8], int color);
 void place_disc(int board[8][8], int row, int col, int color);
 int is_game_over(int board[8][8]);
 int count_discs(int board[8][8], int color);
 int count_flippable(int board[8][8], int row, int col, int color);
-void apply_move(int board[8][8], int row, int col, int color);
+Undo apply_move(int board[8][8], int row, int col, int color);
+void undo_move(int board[8][8], const Undo* undo);
 int count_stones(int board[8][8], int color);
 
 #endif
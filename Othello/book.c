@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "book.h"
+#include "platform.h"
+
+static const char book_magic[8] = { 'O', 'T', 'H', 'B', 'O', 'O', 'K', '2' };
+
+typedef struct {
+    char magic[8];
+    uint64_t count;
+} BookHeader;
+
+static const void* mapping;
+static size_t mapping_size;
+static const BookRecord* records;
+static size_t record_count;
+
+// Records are used in place from the mapping, so only a little-endian host can read them.
+static int host_little_endian(void) {
+    const uint16_t one = 1;
+    return *(const uint8_t*)&one == 1;
+}
+
+int book_open(const char* path) {
+    size_t size;
+    const void* p = map_file(path, &size);
+    const BookHeader* header = p;
+
+    book_close();
+    if (!p) return 0;
+    if (!host_little_endian() || size < sizeof(BookHeader) || memcmp(header->magic, book_magic, sizeof(book_magic)) != 0
+        || (size - sizeof(BookHeader)) / sizeof(BookRecord) < header->count) {
+        unmap_file(p, size);
+        return 0;
+    }
+    mapping = p;
+    mapping_size = size;
+    records = (const BookRecord*)(header + 1);
+    record_count = (size_t)header->count;
+    return 1;
+}
+
+void book_close(void) {
+    if (mapping) unmap_file(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+    records = NULL;
+    record_count = 0;
+}
+
+int book_ready(void) {
+    return records != NULL;
+}
+
+size_t book_size(void) {
+    return record_count;
+}
+
+const BookRecord* book_probe(uint64_t key) {
+    size_t lo = 0, hi = record_count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (records[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < record_count && records[lo].key == key ? &records[lo] : NULL;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = ((const BookRecord*)a)->key, y = ((const BookRecord*)b)->key;
+    return x < y ? -1 : x > y;
+}
+
+int book_write(const char* path, BookRecord* list, size_t count) {
+    uint64_t n = count;
+    FILE* fp = fopen(path, "wb");
+
+    if (!fp) return 0;
+    qsort(list, count, sizeof(BookRecord), compare_keys);
+    int ok = fwrite(book_magic, sizeof(book_magic), 1, fp) == 1 && write_le(fp, &n, sizeof(n), 1);
+    for (size_t i = 0; ok && i < count; i++)
+        ok = write_le(fp, &list[i].key, sizeof(list[i].key), 1) && write_le(fp, &list[i].score, sizeof(list[i].score), 1)
+            && write_le(fp, &list[i].move, 1, 1) && write_le(fp, &list[i].reserved, 1, 1)
+            && write_le(fp, &list[i].games, sizeof(list[i].games), 1);
+    return fclose(fp) == 0 && ok;
+}
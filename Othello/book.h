@@ -0,0 +1,32 @@
+#pragma once
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BOOK_DEFAULT_FILE "othello.book"
+
+// On-disk layout (little-endian): an 8-byte magic "OTHBOOK2", a 64-bit record count,
+// then the records sorted by key with no duplicates. The file is mapped, not read, so
+// opening costs nothing and every process playing from the same book shares its pages;
+// the records are used in place, so a big-endian host cannot open a book.
+typedef struct {
+    uint64_t key;       // bb_canonical_key of the position before the move
+    int16_t score;      // average final disc difference for the side to move
+    uint8_t move;       // square to play, in the canonical frame
+    uint8_t reserved;
+    uint32_t games;     // self-play games the entry is based on
+} BookRecord;
+
+// Replaces the current book with the one at path; 0 if it is missing or malformed.
+int book_open(const char* path);
+void book_close(void);
+int book_ready(void);
+size_t book_size(void);
+// Lookups are read-only and safe from any number of threads once the book is open.
+const BookRecord* book_probe(uint64_t key);
+// Sorts records by key and writes them as a book file; keys must be unique.
+int book_write(const char* path, BookRecord* records, size_t count);
+
+#endif
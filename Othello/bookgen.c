@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "bitboard.h"
+#include "book.h"
+#include "computer.h"
+#include "eval.h"
+#include "platform.h"
+#include "rng.h"
+#include "symmetry.h"
+#include "tt.h"
+
+#define MAX_WORKERS 256
+#define MAX_BOOK_PLIES 60
+
+// One move played in a self-play game, scored with the game's final result.
+typedef struct {
+    uint64_t key;
+    int move;
+    int diff;       // final disc difference for the side that played the move
+} Sample;
+
+typedef struct {
+    int games;
+    int book_plies;
+    int opening_plies;
+    uint64_t seed;
+
+    Mutex lock;
+    int next_game;
+    Sample* samples;
+    size_t sample_count;
+} Builder;
+
+// Plays game g with the search strategy after opening_plies random moves and appends
+// one sample per move in the first book_plies. Seeding matches othello_arena.
+static void play_game(Builder* builder, int g) {
+    Sample local[MAX_BOOK_PLIES];
+    int player[MAX_BOOK_PLIES];
+    int n = 0;
+    Rng opening;
+    ComputerContext ctx;
+    Position pos;
+    int board[8][8];
+    int passes = 0;
+
+    rng_seed(&opening, builder->seed * 0x9e3779b97f4a7c15ULL + (uint64_t)g);
+    computer_init(&ctx, builder->seed * 0xc2b2ae3d27d4eb4fULL + (uint64_t)g);
+    init_board(board);
+    bb_from_board(board, BLACK, &pos);
+
+    for (int ply = 0; passes < 2; ply++) {
+        uint64_t moves = bb_moves(pos.own, pos.opp);
+        Undo undo;
+        int sq;
+
+        if (!moves) {
+            bb_pass(&pos);
+            passes++;
+            continue;
+        }
+        passes = 0;
+
+        if (ply < builder->opening_plies) {
+            for (int i = (int)rng_below(&opening, (uint32_t)bb_count(moves)); i > 0; i--) moves &= moves - 1;
+            sq = bb_first(moves);
+        }
+        else {
+            SearchLimits limits;
+            search_limits_init(&limits, SEARCH);
+            sq = computer_move(&ctx, &pos, &limits);
+        }
+        if (ply < builder->book_plies) {
+            local[n].key = bb_canonical_key(&pos, NULL);
+            local[n].move = sym_canonical_move(&pos, sq);
+            player[n] = pos.color;
+            n++;
+        }
+        bb_make_move(&pos, sq, &undo);
+    }
+
+    int black_diff = (bb_count(pos.own) - bb_count(pos.opp)) * pos.color;
+    for (int i = 0; i < n; i++) local[i].diff = black_diff * player[i];
+    computer_free(&ctx);
+
+    mutex_lock(&builder->lock);
+    memcpy(builder->samples + builder->sample_count, local, n * sizeof(Sample));
+    builder->sample_count += n;
+    mutex_unlock(&builder->lock);
+}
+
+static void worker_main(void* arg) {
+    Builder* builder = arg;
+
+    for (;;) {
+        mutex_lock(&builder->lock);
+        int g = builder->next_game++;
+        mutex_unlock(&builder->lock);
+        if (g >= builder->games) break;
+        play_game(builder, g);
+    }
+}
+
+static int compare_samples(const void* a, const void* b) {
+    const Sample* x = a;
+    const Sample* y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->move - y->move;
+}
+
+// Keeps, for every position, the move with the best average result among the moves
+// played at least min_games times. Returns the number of records written to out.
+static size_t select_moves(Sample* samples, size_t count, int min_games, BookRecord* out) {
+    size_t n = 0;
+
+    qsort(samples, count, sizeof(Sample), compare_samples);
+    for (size_t i = 0; i < count;) {
+        uint64_t key = samples[i].key;
+        uint32_t games = 0;
+        double best = -1e9;
+        int best_move = -1;
+
+        while (i < count && samples[i].key == key) {
+            int move = samples[i].move;
+            long long sum = 0;
+            int played = 0;
+            for (; i < count && samples[i].key == key && samples[i].move == move; i++) {
+                sum += samples[i].diff;
+                played++;
+            }
+            games += (uint32_t)played;
+            if (played >= min_games && (double)sum / played > best) {
+                best = (double)sum / played;
+                best_move = move;
+            }
+        }
+        if (best_move >= 0) {
+            out[n].key = key;
+            out[n].score = (int16_t)(best < 0 ? best - 0.5 : best + 0.5);
+            out[n].move = (uint8_t)best_move;
+            out[n].reserved = 0;
+            out[n].games = games;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: othello_book [options] <output file>\n"
+        "  -n N   number of self-play games (default 1000)\n"
+        "  -j N   games played in parallel (default 1)\n"
+        "  -p N   plies from the start covered by the book (default 14)\n"
+        "  -o N   random opening plies before the search takes over (default 4)\n"
+        "  -g N   games a move needs before it can enter the book (default 2)\n"
+        "  -m MS  per-move search time (default 50)\n"
+        "  -s N   seed for the random openings (default 1)\n");
+}
+
+int main(int argc, char** argv) {
+    static Thread threads[MAX_WORKERS];
+    Builder builder;
+    const char* path = NULL;
+    int workers = 1;
+    int min_games = 2;
+
+    memset(&builder, 0, sizeof(builder));
+    builder.games = 1000;
+    builder.book_plies = 14;
+    builder.opening_plies = 4;
+    builder.seed = 1;
+    set_search_time(50);
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            const char* value = argv[++i];
+            switch (argv[i - 1][1]) {
+            case 'n': builder.games = atoi(value); break;
+            case 'j': workers = atoi(value); break;
+            case 'p': builder.book_plies = atoi(value); break;
+            case 'o': builder.opening_plies = atoi(value); break;
+            case 'g': min_games = atoi(value); break;
+            case 'm': set_search_time(atoi(value)); break;
+            case 's': builder.seed = strtoull(value, NULL, 10); break;
+            default: usage(); return 1;
+            }
+        }
+        else if (!path) {
+            path = argv[i];
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (!path || builder.games < 1) {
+        usage();
+        return 1;
+    }
+    if (builder.book_plies < 0) builder.book_plies = 0;
+    if (builder.book_plies > MAX_BOOK_PLIES) builder.book_plies = MAX_BOOK_PLIES;
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    builder.samples = malloc((size_t)builder.games * builder.book_plies * sizeof(Sample) + 1);
+    if (!builder.samples) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // Shared tables are set up here, before any worker can race to do it.
+    tt_ensure();
+    eval_init();
+
+    mutex_init(&builder.lock);
+    int64_t start = now_ms();
+    for (int i = 1; i < workers; i++)
+        if (!thread_start(&threads[i], worker_main, &builder)) workers = i;
+    worker_main(&builder);
+    for (int i = 1; i < workers; i++) thread_join(&threads[i]);
+    mutex_destroy(&builder.lock);
+
+    BookRecord* records = malloc(builder.sample_count * sizeof(BookRecord) + 1);
+    if (!records) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    size_t count = select_moves(builder.samples, builder.sample_count, min_games, records);
+    if (!book_write(path, records, count)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    printf("%d games, %zu moves sampled, %zu book entries written to %s (%.2f s)\n", builder.games,
+        builder.sample_count, count, path, (now_ms() - start) / 1000.0);
+    free(records);
+    free(builder.samples);
+    return 0;
+}
@@ -1,71 +1,345 @@
 #include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include "board.h"
+#include "bitboard.h"
+#include "book.h"
 #include "computer.h"
+#include "endgame.h"
+#include "eval.h"
+#include "mcts.h"
+#include "nn.h"
+#include "search.h"
+#include "solved.h"
+#include "symmetry.h"
+#include "tt.h"
 
-static const int weights[8][8] = {
-    {100, -20, 10, 5, 5, 10, -20, 100},
-    {-20, -50, -2, -2, -2, -2, -50, -20},
-    {10, -2, 0, 0, 0, 0, -2, 10},
-    {5, -2, 0, 0, 0, 0, -2, 5},
-    {5, -2, 0, 0, 0, 0, -2, 5},
-    {10, -2, 0, 0, 0, 0, -2, 10},
-    {-20, -50, -2, -2, -2, -2, -50, -20},
-    {100, -20, 10, 5, 5, 10, -20, 100}
-};
-
-void get_computer_move(int board[8][8], int color, int* row, int* col, Strategy strategy) {
-    int valid_moves[60][2];
-    int count = 0;
-
-    for (int r = 0; r < 8; r++) {
-        for (int c = 0; c < 8; c++) {
-            if (is_valid_move(board, r, c, color)) {
-                valid_moves[count][0] = r;
-                valid_moves[count][1] = c;
-                count++;
-            }
+// Kept back from every clock allocation for the caller's own overhead.
+#define MOVE_OVERHEAD_MS 5
+// Depth of the search that guesses the opponent's reply when the table has no move.
+#define PONDER_GUESS_DEPTH 4
+
+static int search_time_ms = 1000;
+static int endgame_empties = ENDGAME_DEFAULT_EMPTIES;
+static int search_threads = 1;
+static int mcts_memory_mb = MCTS_DEFAULT_MB;
+
+void set_search_time(int ms) {
+    search_time_ms = ms;
+}
+
+void set_endgame_empties(int n) {
+    endgame_empties = n;
+}
+
+void set_search_threads(int n) {
+    search_threads = n;
+}
+
+void set_mcts_memory(int mb) {
+    mcts_memory_mb = mb;
+}
+
+void set_hash_size(int mb) {
+    tt_init((size_t)mb);
+}
+
+int set_book(const char* path) {
+    return book_open(path);
+}
+
+int set_weights(const char* path) {
+    return eval_load(path);
+}
+
+int set_network(const char* path) {
+    return nn_load(path);
+}
+
+int set_solved_db(const char* path) {
+    return solved_open(path);
+}
+
+static const char* const strategy_names[] = { "random", "maxflip", "weighted", "search", "mcts" };
+
+const char* strategy_name(Strategy strategy) {
+    if ((unsigned)strategy >= sizeof(strategy_names) / sizeof(strategy_names[0])) return "?";
+    return strategy_names[strategy];
+}
+
+int parse_strategy(const char* name, Strategy* strategy) {
+    for (int i = 0; i < (int)(sizeof(strategy_names) / sizeof(strategy_names[0])); i++) {
+        if (strcmp(name, strategy_names[i]) == 0) {
+            *strategy = (Strategy)i;
+            return 1;
         }
     }
+    return 0;
+}
+
+void search_limits_init(SearchLimits* limits, Strategy strategy) {
+    limits->strategy = strategy;
+    limits->depth = 0;
+    limits->nodes = 0;
+    limits->move_ms = 0;
+    limits->clock_ms = 0;
+    limits->increment_ms = 0;
+    limits->stop = NULL;
+    limits->evaluator = EVAL_PATTERNS;
+}
+
+// Relative time per phase: little in the opening, most in the midgame, where the
+// evaluation is least reliable. The endgame solve is one expensive move, after which
+// the remaining moves come from the table almost for free.
+static double phase_weight(int empties, int first_solved) {
+    if (empties <= endgame_empties) return first_solved ? 3.0 : 0.2;
+    return empties > 44 ? 0.6 : empties > 24 ? 1.5 : 1.0;
+}
+
+// Share of the clock for this move: its phase weight against the weight of every move
+// still to play, plus most of the increment, never more than half of what is left.
+static int clock_time(const SearchLimits* limits, int empties) {
+    double total = 0;
+    int solved = 0;
+
+    for (int e = empties; e > 0; e -= 2) {
+        total += phase_weight(e, e <= endgame_empties && !solved);
+        if (e <= endgame_empties) solved = 1;
+    }
+    double share = limits->clock_ms * phase_weight(empties, 1) / total + limits->increment_ms * 0.75;
+    int cap = limits->clock_ms / 2;
+    int ms = (int)share < cap ? (int)share : cap;
+    ms -= MOVE_OVERHEAD_MS;
+    return ms > 1 ? ms : 1;
+}
+
+static int move_time(const SearchLimits* limits, int empties) {
+    if (limits->move_ms > 0) return limits->move_ms;
+    if (limits->clock_ms > 0) return clock_time(limits, empties);
+    if (limits->depth > 0 || limits->nodes > 0) return 0;
+    return search_time_ms;
+}
+
+void computer_init(ComputerContext* ctx, uint64_t seed) {
+    rng_seed(&ctx->rng, seed);
+    memset(&ctx->ponder, 0, sizeof(ctx->ponder));
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    mcts_init(&ctx->mcts);
+}
+
+void computer_free(ComputerContext* ctx) {
+    computer_stop_pondering(ctx);
+    mcts_free(&ctx->mcts);
+}
+
+static int same_position(const Position* a, const Position* b) {
+    return a->own == b->own && a->opp == b->opp && a->color == b->color;
+}
 
-    if (count == 0) {
-        *row = -1;
-        *col = -1;
-        return;
+static void ponder_main(void* arg) {
+    Ponder* p = arg;
+    Position pos = p->pos;
+    uint64_t moves = bb_moves(pos.own, pos.opp);
+    SearchParams params;
+
+    if (moves) {
+        // The expected reply: the table's move if it has one, else a short search.
+        TTEntry entry;
+        int reply;
+        Undo undo;
+        if (tt_probe(pos.hash, &entry) && entry.move >= 0 && (moves & SQ_BIT(entry.move))) {
+            reply = entry.move;
+        }
+        else {
+            SearchResult guess;
+            search_params_init(&params);
+            params.time_ms = 0;
+            params.depth = PONDER_GUESS_DEPTH;
+            params.endgame_empties = 0;
+            params.stop = &p->stop;
+            params.evaluator = p->evaluator;
+            search_best_move(&pos, &params, &guess);
+            reply = guess.move;
+        }
+        bb_make_move(&pos, reply, &undo);
     }
+    else {
+        bb_pass(&pos);
+    }
+    p->target = pos;
+
+    search_params_init(&params);
+    params.time_ms = 0;
+    params.endgame_empties = endgame_empties;
+    params.threads = search_threads;
+    params.stop = &p->stop;
+    params.evaluator = p->evaluator;
+    search_best_move(&pos, &params, &p->result);
+}
+
+void computer_ponder(ComputerContext* ctx, const Position* pos, const SearchLimits* limits) {
+    Ponder* p = &ctx->ponder;
+
+    if (limits->strategy != SEARCH) return;
+    if (p->active && same_position(&p->pos, pos) && p->evaluator == limits->evaluator) return;
+    computer_stop_pondering(ctx);
+    if (!bb_moves(pos->own, pos->opp) && !bb_moves(pos->opp, pos->own)) return;
+
+    tt_ensure();
+    eval_init();
+    p->pos = *pos;
+    p->target = *pos;
+    p->evaluator = limits->evaluator;
+    p->stop = 0;
+    p->result.depth = 0;
+    p->result.move = -1;
+    p->start = now_ms();
+    p->active = thread_start(&p->thread, ponder_main, p);
+}
 
-    int best_index = 0;
+void computer_stop_pondering(ComputerContext* ctx) {
+    Ponder* p = &ctx->ponder;
 
-    if (strategy == RANDOM) {
-        srand((unsigned int)time(NULL));
-        best_index = rand() % count;
+    if (!p->active) return;
+    p->stop = 1;
+    thread_join(&p->thread);
+    p->active = 0;
+    p->elapsed = now_ms() - p->start;
+}
+
+// One move chooser per strategy, all given a non-empty set of legal moves.
+typedef int (*MoveChooser)(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits);
+
+static int random_move(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits) {
+    (void)pos;
+    (void)limits;
+    for (int i = (int)rng_below(&ctx->rng, (uint32_t)bb_count(moves)); i > 0; i--) moves &= moves - 1;
+    return bb_first(moves);
+}
+
+static int max_flip_move(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits) {
+    int best = bb_first(moves);
+    int max_flip = -1;
+
+    (void)ctx;
+    (void)limits;
+    for (; moves; moves &= moves - 1) {
+        int sq = bb_first(moves);
+        int flipped = bb_count(bb_flips(pos->own, pos->opp, sq));
+        if (flipped > max_flip) {
+            max_flip = flipped;
+            best = sq;
+        }
     }
-    else if (strategy == MAX_FLIP) {
-        int max_flip = -1;
-        for (int i = 0; i < count; i++) {
-            int r = valid_moves[i][0];
-            int c = valid_moves[i][1];
-            int flipped = count_flippable(board, r, c, color);
-            if (flipped > max_flip) {
-                max_flip = flipped;
-                best_index = i;
-            }
+    return best;
+}
+
+static int weighted_move(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits) {
+    int best = bb_first(moves);
+    int best_score = -1000;
+
+    (void)ctx;
+    (void)pos;
+    (void)limits;
+    for (; moves; moves &= moves - 1) {
+        int sq = bb_first(moves);
+        int score = weights[sq / 8][sq % 8];
+        if (score > best_score) {
+            best_score = score;
+            best = sq;
         }
     }
-    else if (strategy == WEIGHTED) {
-        int best_score = -1000;
-        for (int i = 0; i < count; i++) {
-            int r = valid_moves[i][0];
-            int c = valid_moves[i][1];
-            int score = weights[r][c];
-            if (score > best_score) {
-                best_score = score;
-                best_index = i;
-            }
+    return best;
+}
+
+static void limits_to_params(const SearchLimits* limits, int empties, SearchParams* params) {
+    search_params_init(params);
+    params->time_ms = move_time(limits, empties);
+    params->depth = limits->depth;
+    params->nodes = limits->nodes;
+    params->stop = limits->stop;
+    params->endgame_empties = limits->depth > 0 && limits->depth < endgame_empties ? limits->depth : endgame_empties;
+    params->threads = search_threads;
+    params->evaluator = limits->evaluator;
+}
+
+static int search_move(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits) {
+    Ponder* p = &ctx->ponder;
+    int hit = 0;
+    int sym;
+    const BookRecord* entry = book_ready() ? book_probe(bb_canonical_key(pos, &sym)) : NULL;
+    SearchParams params;
+    SearchResult result;
+
+    if (p->active) {
+        computer_stop_pondering(ctx);
+        hit = same_position(&p->target, pos) && p->evaluator == limits->evaluator && p->result.depth > 0 && (moves & SQ_BIT(p->result.move));
+        if (hit) p->hits++;
+        else p->misses++;
+    }
+    if (entry) {
+        int sq = sym_square(entry->move, sym_inverse(sym));
+        if (moves & SQ_BIT(sq)) return sq;
+    }
+    int empties = 64 - bb_count(pos->own | pos->opp);
+    limits_to_params(limits, empties, &params);
+
+    // A correct guess has already had this much of the budget; a solved one needs no more.
+    if (hit) {
+        if (p->result.depth >= empties || (params.time_ms > 0 && p->elapsed >= params.time_ms)) {
+            ctx->stats = p->result.stats;
+            return p->result.move;
         }
+        if (params.time_ms > 0) params.time_ms -= (int)p->elapsed;
     }
+    search_best_move(pos, &params, &result);
+    ctx->stats = result.stats;
+    return hit && p->result.depth > result.depth ? p->result.move : result.move;
+}
+
+static int mcts_move(ComputerContext* ctx, const Position* pos, uint64_t moves, const SearchLimits* limits) {
+    MctsParams params;
+    MctsResult result;
+
+    (void)moves;
+    params.time_ms = move_time(limits, 64 - bb_count(pos->own | pos->opp));
+    params.playouts = limits->nodes;
+    params.stop = limits->stop;
+    params.threads = search_threads;
+    params.memory_mb = (size_t)mcts_memory_mb;
+    params.seed = rng_next(&ctx->rng);
+    params.evaluator = limits->evaluator;
+    mcts_search(&ctx->mcts, pos, &params, &result);
+    ctx->stats = result.stats;
+    return result.move;
+}
+
+// Indexed by Strategy.
+static const MoveChooser move_choosers[] = { random_move, max_flip_move, weighted_move, search_move, mcts_move };
+
+int computer_move(ComputerContext* ctx, const Position* pos, const SearchLimits* limits) {
+    uint64_t moves = bb_moves(pos->own, pos->opp);
+
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+    if (!moves) return -1;
+    return move_choosers[limits->strategy](ctx, pos, moves, limits);
+}
+
+int computer_analyze(ComputerContext* ctx, const Position* pos, const SearchLimits* limits, int k, SearchLine* lines) {
+    SearchParams params;
+    SearchResult result;
+
+    if (ctx->ponder.active) computer_stop_pondering(ctx);
+    limits_to_params(limits, 64 - bb_count(pos->own | pos->opp), &params);
+    int count = search_analyze(pos, &params, k, lines, &result);
+    ctx->stats = result.stats;
+    return count;
+}
+
+void get_computer_move(ComputerContext* ctx, int board[8][8], int color, int* row, int* col, const SearchLimits* limits) {
+    Position pos;
+    bb_from_board(board, color, &pos);
 
-    *row = valid_moves[best_index][0];
-    *col = valid_moves[best_index][1];
+    int sq = computer_move(ctx, &pos, limits);
+    *row = sq < 0 ? -1 : sq / 8;
+    *col = sq < 0 ? -1 : sq % 8;
 }
@@ -2,12 +2,98 @@
 #ifndef COMPUTER_H
 #define COMPUTER_H
 
+#include "bitboard.h"
+#include "mcts.h"
+#include "platform.h"
+#include "rng.h"
+#include "search.h"
+
 typedef enum {
     RANDOM,
     MAX_FLIP,
-    WEIGHTED
+    WEIGHTED,
+    SEARCH,
+    MCTS
 } Strategy;
 
-void get_computer_move(int board[8][8], int color, int* row, int* col, Strategy strategy);
+// Search on the opponent's time. A background thread plays the reply it expects and
+// searches the result until told to stop, which warms the transposition table and, on a
+// correct guess, may answer the next move at once.
+typedef struct {
+    Thread thread;
+    volatile int stop;
+    int active;
+    Position pos;           // the opponent's position when pondering started
+    Position target;        // after the predicted reply, engine to move; valid once stopped
+    int64_t start, elapsed;
+    Evaluator evaluator;
+    SearchResult result;
+    int hits, misses;
+} Ponder;
+
+// Per-game (or per-thread) engine state; nothing in it is shared. Not to be copied, or
+// reused while it is pondering; computer_free releases the MCTS tree.
+typedef struct {
+    Rng rng;
+    Ponder ponder;
+    MctsTree mcts;          // kept from move to move for the MCTS strategy
+    SearchStats stats;      // of the last computer_move / get_computer_move, see stats.h
+} ComputerContext;
+
+// What one move may cost. Only the SEARCH and MCTS strategies look past strategy; for
+// MCTS nodes counts playouts and depth is ignored. Time comes from
+// move_ms if set, else from the clock, else there is none when depth or nodes is set, and
+// set_search_time's budget applies when nothing is.
+typedef struct {
+    Strategy strategy;
+    int depth;              // maximum depth, the endgame solve included; 0 = no limit
+    uint64_t nodes;         // 0 = no limit
+    int move_ms;            // fixed time for this move, 0 = none
+    int clock_ms;           // time left on the mover's clock, 0 = no clock
+    int increment_ms;       // added to the clock after each move
+    const volatile int* stop;   // set non-zero from another thread to get a move at once; may be NULL
+    Evaluator evaluator;    // for SEARCH and MCTS, EVAL_PATTERNS by default
+} SearchLimits;
+
+void search_limits_init(SearchLimits* limits, Strategy strategy);
+
+// Default per-move time budget for the SEARCH strategy, in milliseconds.
+void set_search_time(int ms);
+// Transposition table size for the SEARCH strategy, in megabytes.
+void set_hash_size(int mb);
+// Opening book the SEARCH strategy plays from before searching; 0 if it cannot be opened.
+int set_book(const char* path);
+// Evaluation weights written by othello_tune, in place of the built-in tables; 0 if the
+// file is missing or malformed.
+int set_weights(const char* path);
+// Network for the EVAL_NETWORK evaluator, written by nn_save, in place of the built-in
+// stand-in; 0 if the file is missing or malformed.
+int set_network(const char* path);
+// Database of solved endgames the SEARCH strategy reads and adds to, created if missing;
+// 0 if it cannot be opened.
+int set_solved_db(const char* path);
+// The SEARCH strategy plays perfectly from this many empty squares on when the budget allows.
+void set_endgame_empties(int n);
+// Memory for each context's MCTS tree, in megabytes, from its next allocation.
+void set_mcts_memory(int mb);
+// Number of threads the SEARCH and MCTS strategies run on.
+void set_search_threads(int n);
+// Lower-case names ("random", "maxflip", "weighted", "search", "mcts") for command lines and logs;
+// "?" for a value that is none of them, as a corrupt record file can hold.
+const char* strategy_name(Strategy strategy);
+int parse_strategy(const char* name, Strategy* strategy);
+void computer_init(ComputerContext* ctx, uint64_t seed);
+void computer_free(ComputerContext* ctx);
+// Square chosen for the side to move in pos, or -1 if it has to pass.
+int computer_move(ComputerContext* ctx, const Position* pos, const SearchLimits* limits);
+void get_computer_move(ComputerContext* ctx, int board[8][8], int color, int* row, int* col, const SearchLimits* limits);
+// The best k moves for the side to move in pos with exact scores and principal
+// variations, from one search under limits (the strategy is ignored, the book is not
+// used); returns how many lines were filled. See search_analyze.
+int computer_analyze(ComputerContext* ctx, const Position* pos, const SearchLimits* limits, int k, SearchLine* lines);
+// Starts pondering pos, where the opponent is to move; only for the SEARCH strategy.
+// The next computer_move stops it and uses what it found.
+void computer_ponder(ComputerContext* ctx, const Position* pos, const SearchLimits* limits);
+void computer_stop_pondering(ComputerContext* ctx);
 
 #endif
@@ -0,0 +1,344 @@
+#include <string.h>
+#include "endgame.h"
+#include "platform.h"
+#include "search.h"
+#include "solved.h"
+#include "tt.h"
+
+// Below these empty counts the solver switches to cheaper node types.
+#define PARITY_EMPTIES 7
+#define LAST_EMPTIES 4
+#define TT_EMPTIES 10
+
+// Depth tag for exact endgame entries; midgame entries never reach it.
+#define TT_ENDGAME_DEPTH 64
+
+static const uint64_t quadrant_mask[4] = {
+    0x000000000f0f0f0fULL, 0x00000000f0f0f0f0ULL,
+    0x0f0f0f0f00000000ULL, 0xf0f0f0f000000000ULL
+};
+
+typedef struct {
+    uint64_t nodes;
+    int64_t deadline;
+    uint64_t max_nodes;
+    const volatile int* halt;
+    int stop;
+    SearchStats stats;
+} Solver;
+
+static inline int quadrant(int sq) {
+    return ((sq >> 2) & 1) | ((sq >> 4) & 2);
+}
+
+static inline int final_diff(uint64_t own, uint64_t opp) {
+    return bb_count(own) - bb_count(opp);
+}
+
+static inline void check_time(Solver* s) {
+    if ((++s->nodes & 4095) == 0
+        && (now_ms() >= s->deadline || (s->max_nodes && s->nodes >= s->max_nodes) || (s->halt && *s->halt)))
+        s->stop = 1;
+}
+
+// Squares next to each square; a move needs an opponent disc among them.
+static uint64_t neighbour_mask[64];
+static Once neighbour_once = ONCE_INIT;
+
+static void build_neighbour_mask(void) {
+    for (int sq = 0; sq < 64; sq++) neighbour_mask[sq] = bb_neighbors(SQ_BIT(sq));
+}
+
+static int solve_1(Solver* s, uint64_t own, uint64_t opp, int sq) {
+    int diff = 2 * bb_count(own) - 63;
+    int n;
+
+    s->nodes++;
+    if ((opp & neighbour_mask[sq]) && (n = bb_count(bb_flips(own, opp, sq))) != 0) return diff + 2 * n + 1;
+    if ((own & neighbour_mask[sq]) && (n = bb_count(bb_flips(opp, own, sq))) != 0) return diff - 2 * n - 1;
+    return diff;
+}
+
+// 2 to LAST_EMPTIES empties, one specialised function per count.
+#define LAST_N 2
+#define LAST_NEXT 1
+#include "endgame_last.h"
+#define LAST_N 3
+#define LAST_NEXT 2
+#include "endgame_last.h"
+#define LAST_N 4
+#define LAST_NEXT 3
+#include "endgame_last.h"
+
+static int solve_last(Solver* s, uint64_t own, uint64_t opp, int alpha, int beta, const int* empties, int n, int passed) {
+    switch (n) {
+    case 4: return solve_4(s, own, opp, alpha, beta, empties, passed);
+    case 3: return solve_3(s, own, opp, alpha, beta, empties, passed);
+    case 2: return solve_2(s, own, opp, alpha, beta, empties, passed);
+    case 1: return solve_1(s, own, opp, empties[0]);
+    default: return final_diff(own, opp);
+    }
+}
+
+// Empty squares with the ones in odd-sized quadrants first.
+static int parity_empties(uint64_t empty, int parity, int* list) {
+    uint64_t odd = 0;
+    int n = 0;
+    for (int q = 0; q < 4; q++)
+        if (parity & (1 << q)) odd |= quadrant_mask[q];
+
+    for (uint64_t b = empty & odd; b; b &= b - 1) list[n++] = bb_first(b);
+    for (uint64_t b = empty & ~odd; b; b &= b - 1) list[n++] = bb_first(b);
+    return n;
+}
+
+static int solve_parity(Solver* s, uint64_t own, uint64_t opp, int alpha, int beta, int parity, int passed) {
+    uint64_t empty = ~(own | opp);
+    int n_empty = bb_count(empty);
+
+    if (n_empty <= LAST_EMPTIES) {
+        int list[LAST_EMPTIES];
+        int n = parity_empties(empty, parity, list);
+        return solve_last(s, own, opp, alpha, beta, list, n, passed);
+    }
+
+    check_time(s);
+    if (s->stop) return 0;
+
+    STAT_START(t);
+    uint64_t moves = bb_moves(own, opp);
+    STAT_ELAPSED(&s->stats, movegen_ticks, t);
+    if (!moves) {
+        if (passed) return final_diff(own, opp);
+        return -solve_parity(s, opp, own, -beta, -alpha, parity, 1);
+    }
+    STAT_ADD(&s->stats, expanded, 1);
+    STAT_ADD(&s->stats, children, bb_count(moves));
+
+    uint64_t odd = 0;
+    for (int q = 0; q < 4; q++)
+        if (parity & (1 << q)) odd |= quadrant_mask[q];
+
+    int best = -SCORE_INF;
+    int tried = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        uint64_t group = moves & (pass == 0 ? odd : ~odd);
+        for (; group; group &= group - 1) {
+            int sq = bb_first(group);
+            uint64_t flipped = bb_flips(own, opp, sq);
+            int score = -solve_parity(s, opp ^ flipped, own | flipped | SQ_BIT(sq), -beta, -alpha,
+                parity ^ (1 << quadrant(sq)), 0);
+            if (s->stop) return 0;
+            tried++;
+            if (score > best) {
+                best = score;
+                if (score > alpha && (alpha = score) >= beta) {
+                    STAT_ADD(&s->stats, cutoffs, 1);
+                    STAT_ADD(&s->stats, first_cutoffs, tried == 1);
+                    return best;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+static int empty_parity(uint64_t empty) {
+    int parity = 0;
+    for (int q = 0; q < 4; q++)
+        if (bb_count(empty & quadrant_mask[q]) & 1) parity |= 1 << q;
+    return parity;
+}
+
+// Fastest-first: moves leaving the opponent fewest replies go first, corners break ties.
+static int order_moves(const Position* pos, uint64_t moves, int tt_move, int* list) {
+    int keys[BB_MAX_MOVES];
+    int n = 0;
+
+    for (; moves; moves &= moves - 1) {
+        int sq = bb_first(moves);
+        uint64_t flipped = bb_flips(pos->own, pos->opp, sq);
+        uint64_t own = pos->own | flipped | SQ_BIT(sq);
+        int key = bb_count(bb_moves(pos->opp ^ flipped, own)) * 2;
+        if (SQ_BIT(sq) & 0x8100000000000081ULL) key -= 1;
+        if (sq == tt_move) key = -100;
+
+        int i = n++;
+        while (i > 0 && keys[i - 1] > key) {
+            keys[i] = keys[i - 1];
+            list[i] = list[i - 1];
+            i--;
+        }
+        keys[i] = key;
+        list[i] = sq;
+    }
+    return n;
+}
+
+static int solve_deep(Solver* s, Position* pos, int alpha, int beta, int passed) {
+    uint64_t empty = ~(pos->own | pos->opp);
+    int n_empty = bb_count(empty);
+
+    if (n_empty <= PARITY_EMPTIES)
+        return solve_parity(s, pos->own, pos->opp, alpha, beta, empty_parity(empty), passed);
+
+    check_time(s);
+    if (s->stop) return 0;
+
+    // Large enough to be worth keeping: look it up, and record it below if it comes out exact.
+    int keep = n_empty >= SOLVED_MIN_EMPTIES && solved_ready();
+    int64_t start = 0;
+    if (keep) {
+        int score, move;
+        if (solved_probe(pos, &score, &move)) return score;
+        start = now_ms();
+    }
+
+    TTEntry entry;
+    int tt_move = -1;
+    if (n_empty >= TT_EMPTIES) STAT_ADD(&s->stats, tt_probes, 1);
+    if (n_empty >= TT_EMPTIES && tt_probe(pos->hash, &entry)) {
+        STAT_ADD(&s->stats, tt_hits, 1);
+        tt_move = entry.move;
+        if (entry.depth >= TT_ENDGAME_DEPTH) {
+            int score = score_to_diff(entry.score);
+            if (entry.bound == TT_EXACT) return score;
+            if (entry.bound == TT_LOWER && score >= beta) return score;
+            if (entry.bound == TT_UPPER && score <= alpha) return score;
+        }
+    }
+
+    STAT_START(t);
+    uint64_t moves = bb_moves(pos->own, pos->opp);
+    STAT_ELAPSED(&s->stats, movegen_ticks, t);
+    if (!moves) {
+        if (passed) return final_diff(pos->own, pos->opp);
+        bb_pass(pos);
+        int score = -solve_deep(s, pos, -beta, -alpha, 1);
+        bb_pass(pos);
+        return score;
+    }
+
+    STAT_ADD(&s->stats, expanded, 1);
+    STAT_ADD(&s->stats, children, bb_count(moves));
+
+    int list[BB_MAX_MOVES];
+    int n = order_moves(pos, moves, tt_move, list);
+    int alpha_orig = alpha;
+    int best = -SCORE_INF;
+    int best_move = -1;
+
+    for (int i = 0; i < n; i++) {
+        Undo undo;
+        bb_make_move(pos, list[i], &undo);
+        int score = -solve_deep(s, pos, -beta, -alpha, 0);
+        bb_undo_move(pos, &undo);
+        if (s->stop) return 0;
+        if (score > best) {
+            best = score;
+            best_move = list[i];
+            if (score > alpha && (alpha = score) >= beta) {
+                STAT_ADD(&s->stats, cutoffs, 1);
+                STAT_ADD(&s->stats, first_cutoffs, i == 0);
+                break;
+            }
+        }
+    }
+
+    if (n_empty >= TT_EMPTIES) {
+        int bound = best >= beta ? TT_LOWER : best > alpha_orig ? TT_EXACT : TT_UPPER;
+        tt_store(pos->hash, TT_ENDGAME_DEPTH, bound, diff_to_score(best), best_move);
+        if (keep && bound == TT_EXACT) solved_store(pos, best, best_move, now_ms() - start);
+    }
+    return best;
+}
+
+// Inserts a move that beats the k-th best so far into the list, kept best first; returns
+// the new count.
+static int insert_line(int* moves, int* scores, int n, int k, int move, int score) {
+    int i = n < k ? n++ : k - 1;
+    for (; i > 0 && scores[i - 1] < score; i--) {
+        moves[i] = moves[i - 1];
+        scores[i] = scores[i - 1];
+    }
+    moves[i] = move;
+    scores[i] = score;
+    return n;
+}
+
+int endgame_solve_lines(const Position* pos, int k, int64_t deadline, uint64_t max_nodes, const volatile int* halt,
+    int* moves_out, int* scores_out, int* count, EndgameResult* result) {
+    Solver s;
+    Position root = *pos;
+    uint64_t moves = bb_moves(root.own, root.opp);
+    tt_ensure();
+    run_once(&neighbour_once, build_neighbour_mask);
+    int64_t start = now_ms();
+    int best_moves[BB_MAX_MOVES] = { -1 }, best_scores[BB_MAX_MOVES] = { 0 };
+    int found = 0;
+
+    s.nodes = 0;
+    s.deadline = deadline;
+    s.max_nodes = max_nodes;
+    s.halt = halt;
+    s.stop = 0;
+    memset(&s.stats, 0, sizeof(s.stats));
+    if (k < 1) k = 1;
+    if (k > BB_MAX_MOVES) k = BB_MAX_MOVES;
+
+    result->move = -1;
+    result->nodes = 0;
+    result->stats = s.stats;
+    *count = 0;
+    // The database knows only the best move, which is all a single line needs.
+    if (k == 1 && solved_probe(&root, &result->score, &result->move)) {
+        if (result->move >= 0) {
+            moves_out[0] = result->move;
+            scores_out[0] = result->score;
+            *count = 1;
+        }
+        return 1;
+    }
+    if (!moves) {
+        bb_pass(&root);
+        result->score = -solve_deep(&s, &root, -64, 64, 1);
+        result->nodes = s.nodes;
+        result->stats = s.stats;
+        return !s.stop;
+    }
+
+    TTEntry entry;
+    int tt_move = tt_probe(root.hash, &entry) ? entry.move : -1;
+    int list[BB_MAX_MOVES];
+    int n = order_moves(&root, moves, tt_move, list);
+
+    // A move only has to be searched exactly if it may beat the k-th best so far.
+    for (int i = 0; i < n; i++) {
+        int alpha = found < k ? -SCORE_INF : best_scores[k - 1];
+        Undo undo;
+        bb_make_move(&root, list[i], &undo);
+        int score = -solve_deep(&s, &root, -64, alpha == -SCORE_INF ? 64 : -alpha, 0);
+        bb_undo_move(&root, &undo);
+        if (s.stop) break;
+        if (score > alpha) found = insert_line(best_moves, best_scores, found, k, list[i], score);
+    }
+
+    result->nodes = s.nodes;
+    result->stats = s.stats;
+    if (s.stop) return 0;
+    result->move = best_moves[0];
+    result->score = best_scores[0];
+    for (int i = 0; i < found; i++) {
+        moves_out[i] = best_moves[i];
+        scores_out[i] = best_scores[i];
+    }
+    *count = found;
+    tt_store(root.hash, TT_ENDGAME_DEPTH, TT_EXACT, diff_to_score(result->score), result->move);
+    solved_store(&root, result->score, result->move, now_ms() - start);
+    return 1;
+}
+
+int endgame_solve(const Position* pos, int64_t deadline, uint64_t max_nodes, const volatile int* halt, EndgameResult* result) {
+    int move, score, count;
+    return endgame_solve_lines(pos, 1, deadline, max_nodes, halt, &move, &score, &count, result);
+}
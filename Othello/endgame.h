@@ -0,0 +1,26 @@
+#pragma once
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "bitboard.h"
+#include "stats.h"
+
+#define ENDGAME_DEFAULT_EMPTIES 16
+
+typedef struct {
+    int move;       // best square, -1 when the side to move must pass
+    int score;      // exact final disc difference for the side to move
+    uint64_t nodes;
+    SearchStats stats;  // counters only, see stats.h
+} EndgameResult;
+
+// Solves pos exactly. Returns 0 if the deadline passed, max_nodes (0 = no limit) were
+// searched or *halt (may be NULL) was set before the solve finished.
+int endgame_solve(const Position* pos, int64_t deadline, uint64_t max_nodes, const volatile int* halt, EndgameResult* result);
+// As endgame_solve, and also scores the best k root moves (at most BB_MAX_MOVES) exactly: *count
+// of them, best first, go to moves and scores. The other moves are only shown to be no
+// better, so the solve costs far less than k separate ones.
+int endgame_solve_lines(const Position* pos, int k, int64_t deadline, uint64_t max_nodes, const volatile int* halt,
+    int* moves, int* scores, int* count, EndgameResult* result);
+
+#endif
@@ -0,0 +1,48 @@
+// Solver for exactly LAST_N empties, included by endgame.c once per LAST_N from 2 to
+// LAST_EMPTIES with solve_<LAST_N - 1> already defined. With the count a constant the
+// compiler unrolls the loops over the empty squares, and each child gets its own
+// shorter list instead of the parent's list being permuted in place.
+#ifndef LAST_N
+#error "define LAST_N before including endgame_last.h"
+#endif
+
+#define LAST_PASTE_(a, b) a##b
+#define LAST_PASTE(a, b) LAST_PASTE_(a, b)
+#define SOLVE_N LAST_PASTE(solve_, LAST_N)
+
+static int SOLVE_N(Solver* s, uint64_t own, uint64_t opp, int alpha, int beta, const int* empties, int passed) {
+    int best = -SCORE_INF;
+
+    s->nodes++;
+    for (int i = 0; i < LAST_N; i++) {
+        int sq = empties[i];
+        if (!(opp & neighbour_mask[sq])) continue;
+        uint64_t flipped = bb_flips(own, opp, sq);
+        if (!flipped) continue;
+
+        int rest[LAST_N - 1];
+        for (int j = 0, k = 0; j < LAST_N; j++)
+            if (j != i) rest[k++] = empties[j];
+#if LAST_N == 2
+        int score = -solve_1(s, opp ^ flipped, own | flipped | SQ_BIT(sq), rest[0]);
+#else
+        int score = -LAST_PASTE(solve_, LAST_NEXT)(s, opp ^ flipped, own | flipped | SQ_BIT(sq), -beta, -alpha, rest, 0);
+#endif
+        if (score > best) {
+            best = score;
+            if (score > alpha && (alpha = score) >= beta) return best;
+        }
+    }
+
+    if (best == -SCORE_INF) {
+        if (passed) return final_diff(own, opp);
+        return -SOLVE_N(s, opp, own, -beta, -alpha, empties, 1);
+    }
+    return best;
+}
+
+#undef SOLVE_N
+#undef LAST_PASTE
+#undef LAST_PASTE_
+#undef LAST_NEXT
+#undef LAST_N
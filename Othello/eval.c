@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+#include "eval.h"
+#include "platform.h"
+
+#define BATCH_CHUNK 64
+
+const int weights[8][8] = {
+    {100, -20, 10, 5, 5, 10, -20, 100},
+    {-20, -50, -2, -2, -2, -2, -50, -20},
+    {10, -2, 0, 0, 0, 0, -2, 10},
+    {5, -2, 0, 0, 0, 0, -2, 5},
+    {5, -2, 0, 0, 0, 0, -2, 5},
+    {10, -2, 0, 0, 0, 0, -2, 10},
+    {-20, -50, -2, -2, -2, -2, -50, -20},
+    {100, -20, 10, 5, 5, 10, -20, 100}
+};
+
+int16_t eval_weights[EVAL_PHASES][EVAL_WEIGHTS];
+
+// Index 0 is the last phase (fewest empties).
+int eval_mobility[EVAL_PHASES] = { 4, 8, 8, 6 };
+int eval_potential[EVAL_PHASES] = { 1, 3, 3, 3 };
+int eval_frontier[EVAL_PHASES] = { -1, -3, -3, -2 };
+
+enum { EDGE, CORNER, DIAG, PATTERN_TYPES };
+
+static const int type_size[PATTERN_TYPES] = { 8, 9, 8 };
+static const int type_offset[PATTERN_TYPES] = { 0, 6561, 6561 + 19683 };
+
+// Squares of every feature, digit 0 first. Instances of one type are symmetric images of
+// each other so they share a table.
+static const int feature_type[EVAL_FEATURES] = { EDGE, EDGE, EDGE, EDGE, CORNER, CORNER, CORNER, CORNER, DIAG, DIAG };
+static const int feature_squares[EVAL_FEATURES][9] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7 },
+    { 56, 57, 58, 59, 60, 61, 62, 63 },
+    { 0, 8, 16, 24, 32, 40, 48, 56 },
+    { 7, 15, 23, 31, 39, 47, 55, 63 },
+    { 0, 1, 2, 8, 9, 10, 16, 17, 18 },
+    { 7, 6, 5, 15, 14, 13, 23, 22, 21 },
+    { 56, 57, 58, 48, 49, 50, 40, 41, 42 },
+    { 63, 62, 61, 55, 54, 53, 47, 46, 45 },
+    { 0, 9, 18, 27, 36, 45, 54, 63 },
+    { 7, 14, 21, 28, 35, 42, 49, 56 }
+};
+
+EvalSquare eval_squares[64];
+static Once tables_once = ONCE_INIT;
+
+static const char weights_magic[8] = { 'O', 'T', 'H', 'W', 'G', 'T', '0', '1' };
+
+static int corner_of(int sq) {
+    int r = sq / 8, c = sq % 8;
+    int cr = r < 4 ? 0 : 7, cc = c < 4 ? 0 : 7;
+    int dr = r > cr ? r - cr : cr - r, dc = c > cc ? c - cc : cc - c;
+    return (dr <= 1 && dc <= 1 && dr + dc > 0) ? SQ(cr, cc) : -1;
+}
+
+// Default value of one pattern code: the weights[8][8] score of its discs, each square
+// shared evenly between the features covering it. C and X squares stop counting against
+// their owner once the corner next to them is taken.
+static int default_value(int type, int code, const int* squares) {
+    int digit[9];
+    int value = 0;
+
+    for (int i = 0; i < type_size[type]; i++, code /= 3) digit[i] = code % 3;
+    for (int i = 0; i < type_size[type]; i++) {
+        int sq = squares[i];
+        int w = weights[sq / 8][sq % 8];
+        int corner = corner_of(sq);
+
+        if (!digit[i]) continue;
+        for (int j = 0; j < type_size[type]; j++)
+            if (squares[j] == corner && digit[j]) w = 0;
+        w /= eval_squares[sq].count;
+        value += digit[i] == 1 ? w : -w;
+    }
+    return value;
+}
+
+static void build_tables(void) {
+    for (int sq = 0; sq < 64; sq++) eval_squares[sq].count = 0;
+    for (int f = 0; f < EVAL_FEATURES; f++) {
+        int power = 1;
+        for (int i = 0; i < type_size[feature_type[f]]; i++, power *= 3) {
+            EvalSquare* sf = &eval_squares[feature_squares[f][i]];
+            sf->feature[sf->count] = (uint8_t)f;
+            sf->power[sf->count] = (uint16_t)power;
+            sf->count++;
+        }
+    }
+
+    // Feature 4 (first corner), 0 (first edge) and 8 (first diagonal) define the defaults.
+    static const int type_feature[PATTERN_TYPES] = { 0, 4, 8 };
+    for (int t = 0; t < PATTERN_TYPES; t++) {
+        int codes = 1;
+        for (int i = 0; i < type_size[t]; i++) codes *= 3;
+        for (int code = 0; code < codes; code++) {
+            int16_t value = (int16_t)default_value(t, code, feature_squares[type_feature[t]]);
+            for (int p = 0; p < EVAL_PHASES; p++) eval_weights[p][type_offset[t] + code] = value;
+        }
+    }
+}
+
+void eval_init(void) {
+    run_once(&tables_once, build_tables);
+}
+
+void eval_state_init(EvalState* state, const Position* pos) {
+    uint64_t black = pos->color == BLACK ? pos->own : pos->opp;
+    uint64_t white = pos->color == BLACK ? pos->opp : pos->own;
+
+    for (int f = 0; f < EVAL_FEATURES; f++) state->code[f] = 0;
+    for (; black; black &= black - 1) eval_add_digit(state, bb_first(black), 1);
+    for (; white; white &= white - 1) eval_add_digit(state, bb_first(white), 2);
+}
+
+// Mobility, potential mobility and frontier difference, all from popcounts.
+static inline void mobility_terms(const Position* pos, int terms[EVAL_TERMS]) {
+    uint64_t empty = ~(pos->own | pos->opp);
+    uint64_t near_empty = bb_neighbors(empty);
+
+    terms[0] = bb_count(bb_moves(pos->own, pos->opp)) - bb_count(bb_moves(pos->opp, pos->own));
+    terms[1] = bb_count(bb_neighbors(pos->opp) & empty) - bb_count(bb_neighbors(pos->own) & empty);
+    terms[2] = bb_count(pos->own & near_empty) - bb_count(pos->opp & near_empty);
+}
+
+static int mobility_score(const Position* pos, int phase) {
+    int terms[EVAL_TERMS];
+
+    mobility_terms(pos, terms);
+    return eval_mobility[phase] * terms[0] + eval_potential[phase] * terms[1] + eval_frontier[phase] * terms[2];
+}
+
+int eval_state_score(const EvalState* state, const Position* pos) {
+    int phase = EVAL_PHASE(64 - bb_count(pos->own | pos->opp));
+    const int16_t* w = eval_weights[phase];
+    int score = 0;
+
+    for (int f = 0; f < EVAL_FEATURES; f++) score += w[type_offset[feature_type[f]] + state->code[f]];
+    return score * pos->color + mobility_score(pos, phase);
+}
+
+int evaluate(const Position* pos) {
+    EvalState state;
+    eval_init();
+    eval_state_init(&state, pos);
+    return eval_state_score(&state, pos);
+}
+
+void eval_batch(const uint64_t* own, const uint64_t* opp, int n, int* scores) {
+    uint16_t code[EVAL_FEATURES][BATCH_CHUNK];
+    int phase[BATCH_CHUNK];
+
+    eval_init();
+    for (int base = 0; base < n; base += BATCH_CHUNK) {
+        const uint64_t* o = own + base;
+        const uint64_t* p = opp + base;
+        int m = n - base < BATCH_CHUNK ? n - base : BATCH_CHUNK;
+
+        // Codes square by square across the chunk, own discs as black.
+        for (int f = 0; f < EVAL_FEATURES; f++) {
+            int power = 1;
+            for (int i = 0; i < m; i++) code[f][i] = 0;
+            for (int k = 0; k < type_size[feature_type[f]]; k++, power *= 3) {
+                int sq = feature_squares[f][k];
+                for (int i = 0; i < m; i++)
+                    code[f][i] = (uint16_t)(code[f][i] + power * (int)(((o[i] >> sq) & 1) + 2 * ((p[i] >> sq) & 1)));
+            }
+        }
+        for (int i = 0; i < m; i++) phase[i] = EVAL_PHASE(64 - bb_count(o[i] | p[i]));
+
+        for (int i = 0; i < m; i++) {
+            const int16_t* w = eval_weights[phase[i]];
+            Position pos = { o[i], p[i], 0, BLACK };
+            int score = 0;
+            for (int f = 0; f < EVAL_FEATURES; f++) score += w[type_offset[feature_type[f]] + code[f][i]];
+            scores[base + i] = score + mobility_score(&pos, phase[i]);
+        }
+    }
+}
+
+void eval_features(const Position* pos, uint16_t index[EVAL_FEATURES], int terms[EVAL_TERMS]) {
+    EvalState state;
+
+    eval_init();
+    eval_state_init(&state, pos);
+    for (int f = 0; f < EVAL_FEATURES; f++) index[f] = (uint16_t)(type_offset[feature_type[f]] + state.code[f]);
+    mobility_terms(pos, terms);
+}
+
+int eval_swapped_index(int index) {
+    int t = index >= type_offset[DIAG] ? DIAG : index >= type_offset[CORNER] ? CORNER : EDGE;
+    int code = index - type_offset[t];
+    int swapped = 0;
+
+    for (int i = 0, power = 1; i < type_size[t]; i++, power *= 3, code /= 3) {
+        int digit = code % 3;
+        swapped += power * (digit ? 3 - digit : 0);
+    }
+    return type_offset[t] + swapped;
+}
+
+// The file is the magic, eval_weights as is, then the three mobility coefficient rows
+// as int16, all little-endian.
+int eval_save(const char* path) {
+    int16_t terms[EVAL_TERMS][EVAL_PHASES];
+    FILE* fp = fopen(path, "wb");
+
+    if (!fp) return 0;
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        terms[0][p] = (int16_t)eval_mobility[p];
+        terms[1][p] = (int16_t)eval_potential[p];
+        terms[2][p] = (int16_t)eval_frontier[p];
+    }
+    int ok = fwrite(weights_magic, sizeof(weights_magic), 1, fp) == 1
+        && write_le(fp, eval_weights, sizeof(int16_t), EVAL_PHASES * EVAL_WEIGHTS)
+        && write_le(fp, terms, sizeof(int16_t), EVAL_TERMS * EVAL_PHASES);
+    return fclose(fp) == 0 && ok;
+}
+
+int eval_load(const char* path) {
+    static int16_t table[EVAL_PHASES][EVAL_WEIGHTS];
+    int16_t terms[EVAL_TERMS][EVAL_PHASES];
+    char magic[sizeof(weights_magic)];
+    FILE* fp = fopen(path, "rb");
+
+    if (!fp) return 0;
+    int ok = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, weights_magic, sizeof(magic)) == 0
+        && read_le(fp, table, sizeof(int16_t), EVAL_PHASES * EVAL_WEIGHTS)
+        && read_le(fp, terms, sizeof(int16_t), EVAL_TERMS * EVAL_PHASES) && fgetc(fp) == EOF;
+    fclose(fp);
+
+    // eval_batch and the colour flip in eval_state_score rely on swapping the colours
+    // negating a pattern's value.
+    for (int p = 0; ok && p < EVAL_PHASES; p++)
+        for (int i = 0; ok && i < EVAL_WEIGHTS; i++)
+            ok = table[p][eval_swapped_index(i)] == -table[p][i];
+    if (!ok) return 0;
+
+    eval_init();
+    memcpy(eval_weights, table, sizeof(table));
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        eval_mobility[p] = terms[0][p];
+        eval_potential[p] = terms[1][p];
+        eval_frontier[p] = terms[2][p];
+    }
+    return 1;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "bitboard.h"
+
+// Pattern evaluation: each feature is one instance of an edge, 3x3 corner or long-diagonal
+// pattern, identified by the base-3 code of its squares (0 empty, 1 black, 2 white).
+#define EVAL_FEATURES 10
+#define EVAL_PHASES 4
+#define EVAL_WEIGHTS (6561 + 19683 + 6561)   // edge, corner and diagonal tables of one phase
+#define EVAL_TERMS 3                            // mobility, potential mobility, frontier
+#define EVAL_DEFAULT_FILE "othello.weights"
+
+// Game phase from the number of empty squares.
+#define EVAL_PHASE(empties) ((empties) >= 60 ? EVAL_PHASES - 1 : (empties) / 16)
+
+// Which static evaluation a search scores its leaves with: these patterns, or the network
+// in nn.h.
+typedef enum {
+    EVAL_PATTERNS,
+    EVAL_NETWORK
+} Evaluator;
+
+typedef struct {
+    uint16_t code[EVAL_FEATURES];
+} EvalState;
+
+// Features covering a square and the square's place value in each, filled by eval_init.
+typedef struct {
+    int count;
+    uint8_t feature[4];
+    uint16_t power[4];
+} EvalSquare;
+
+extern EvalSquare eval_squares[64];
+
+extern const int weights[8][8];
+
+// Scores from black's point of view, per phase.
+extern int16_t eval_weights[EVAL_PHASES][EVAL_WEIGHTS];
+
+// Per-phase coefficients of the mobility terms, from the side to move's point of view:
+// legal moves, empty squares next to the opponent's discs, own discs next to an empty square.
+extern int eval_mobility[EVAL_PHASES];
+extern int eval_potential[EVAL_PHASES];
+extern int eval_frontier[EVAL_PHASES];
+
+// Fills eval_squares, and eval_weights with the defaults derived from weights[8][8], the
+// first time it is called; safe from any number of threads at once.
+void eval_init(void);
+
+void eval_state_init(EvalState* state, const Position* pos);
+
+static inline void eval_add_digit(EvalState* state, int sq, int delta) {
+    const EvalSquare* es = &eval_squares[sq];
+    for (int i = 0; i < es->count; i++)
+        state->code[es->feature[i]] = (uint16_t)(state->code[es->feature[i]] + delta * es->power[i]);
+}
+
+// Keep state in step with bb_make_move / bb_undo_move; color is the side that moved.
+// Inline and free of colour tests: with BLACK = 1 and WHITE = -1 the placed disc is digit
+// (3 - color) / 2 and a flip changes a digit by -color.
+static inline void eval_make_move(EvalState* state, int sq, uint64_t flipped, int color) {
+    eval_add_digit(state, sq, (3 - color) / 2);
+    for (; flipped; flipped &= flipped - 1) eval_add_digit(state, bb_first(flipped), -color);
+}
+
+static inline void eval_undo_move(EvalState* state, int sq, uint64_t flipped, int color) {
+    eval_add_digit(state, sq, -(3 - color) / 2);
+    for (; flipped; flipped &= flipped - 1) eval_add_digit(state, bb_first(flipped), color);
+}
+int eval_state_score(const EvalState* state, const Position* pos);
+
+// Static score of pos from the side to move's point of view.
+int evaluate(const Position* pos);
+
+// Static scores of n positions given as separate own / opp arrays (side to move first),
+// the layout the per-feature loops vectorise over. Equal to evaluate() for either colour
+// to move as long as the weights are colour-symmetric, which the defaults are.
+void eval_batch(const uint64_t* own, const uint64_t* opp, int n, int* scores);
+
+// Tuning interface. eval_features gives the table index of every feature of pos (codes
+// from black's point of view) and the mobility terms for the side to move, so that for
+// black to move evaluate() is the sum of eval_weights[phase][index[f]] plus the terms
+// times their phase coefficients. eval_swapped_index is the same pattern with the colours
+// swapped, whose value must be the negation.
+void eval_features(const Position* pos, uint16_t index[EVAL_FEATURES], int terms[EVAL_TERMS]);
+int eval_swapped_index(int index);
+
+// Writes the current tables, or replaces them with a file written by eval_save. A file
+// that is malformed or not colour-symmetric is rejected and the tables are left as they are.
+int eval_save(const char* path);
+int eval_load(const char* path);
+
+#endif
@@ -0,0 +1,74 @@
+#include "board.h"
+#include "gamestate.h"
+
+// Recomputes the move mask for the side to move and packs the state bits around it.
+// A side without moves whose opponent cannot move either ends the game.
+static void update(GameState* gs, int color, int passes) {
+    uint64_t own = color == BLACK ? gs->black : gs->white;
+    uint64_t opp = color == BLACK ? gs->white : gs->black;
+    uint64_t moves = bb_moves(own, opp) & ~GS_META;
+
+    if (!moves && !bb_moves(opp, own)) passes = 2;
+    gs->moves = moves | (color == WHITE ? GS_WHITE_TO_MOVE : 0)
+        | (passes & 1 ? GS_PASS_LOW : 0) | (passes & 2 ? GS_PASS_HIGH : 0);
+}
+
+void gs_init(GameState* gs) {
+    gs->black = SQ_BIT(SQ(3, 4)) | SQ_BIT(SQ(4, 3));
+    gs->white = SQ_BIT(SQ(3, 3)) | SQ_BIT(SQ(4, 4));
+    update(gs, BLACK, 0);
+}
+
+int gs_from_board(GameState* gs, int board[8][8], int color) {
+    uint64_t black, white;
+
+    bb_board_masks(board, BLACK, &black, &white);
+    if (((black | white) & GS_META) != GS_META) return 0;
+    gs->black = black;
+    gs->white = white;
+    update(gs, color, 0);
+    return 1;
+}
+
+void gs_to_board(const GameState* gs, int board[8][8]) {
+    for (int sq = 0; sq < 64; sq++)
+        board[sq / 8][sq % 8] = gs->black & SQ_BIT(sq) ? BLACK : gs->white & SQ_BIT(sq) ? WHITE : EMPTY;
+}
+
+void gs_to_position(const GameState* gs, Position* pos) {
+    int color = gs_color(gs);
+    bb_set_position(pos, color == BLACK ? gs->black : gs->white, color == BLACK ? gs->white : gs->black, color);
+}
+
+int gs_from_position(GameState* gs, const Position* pos) {
+    if (((pos->own | pos->opp) & GS_META) != GS_META) return 0;
+    gs->black = pos->color == BLACK ? pos->own : pos->opp;
+    gs->white = pos->color == BLACK ? pos->opp : pos->own;
+    update(gs, pos->color, 0);
+    return 1;
+}
+
+int gs_play(GameState* gs, int sq) {
+    int color = gs_color(gs);
+    uint64_t own = color == BLACK ? gs->black : gs->white;
+    uint64_t opp = color == BLACK ? gs->white : gs->black;
+
+    if (sq < 0 || sq > 63 || !(gs_moves(gs) & SQ_BIT(sq))) return 0;
+    uint64_t flipped = bb_flips(own, opp, sq);
+    own |= flipped | SQ_BIT(sq);
+    opp ^= flipped;
+    gs->black = color == BLACK ? own : opp;
+    gs->white = color == BLACK ? opp : own;
+    update(gs, -color, 0);
+    return 1;
+}
+
+int gs_pass(GameState* gs) {
+    if (gs_moves(gs) || gs_is_over(gs)) return 0;
+    update(gs, -gs_color(gs), gs_passes(gs) + 1);
+    return 1;
+}
+
+int gs_count(const GameState* gs, int color) {
+    return bb_count(color == BLACK ? gs->black : gs->white);
+}
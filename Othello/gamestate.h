@@ -0,0 +1,55 @@
+#pragma once
+#ifndef GAMESTATE_H
+#define GAMESTATE_H
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "board.h"
+
+// A whole game position in 24 bytes: both colours' discs and the legal moves of the side
+// to move. The centre squares are occupied in every position of a game, so they are never
+// legal; three of their bits in moves hold the side to move and the passes in a row.
+// Two passes in a row end the game, which makes the game-over test a bit check.
+typedef struct {
+    uint64_t black;
+    uint64_t white;
+    uint64_t moves;
+} GameState;
+
+#define GS_WHITE_TO_MOVE SQ_BIT(27)
+#define GS_PASS_LOW SQ_BIT(28)
+#define GS_PASS_HIGH SQ_BIT(35)
+#define GS_META (GS_WHITE_TO_MOVE | GS_PASS_LOW | GS_PASS_HIGH)
+
+static inline int gs_color(const GameState* gs) {
+    return gs->moves & GS_WHITE_TO_MOVE ? WHITE : BLACK;
+}
+
+static inline uint64_t gs_moves(const GameState* gs) {
+    return gs->moves & ~GS_META;
+}
+
+// Passes in a row: 0, 1, or 2 once neither side can move.
+static inline int gs_passes(const GameState* gs) {
+    return (gs->moves & GS_PASS_LOW ? 1 : 0) | (gs->moves & GS_PASS_HIGH ? 2 : 0);
+}
+
+static inline int gs_is_over(const GameState* gs) {
+    return (gs->moves & GS_PASS_HIGH) != 0;
+}
+
+void gs_init(GameState* gs);
+// Packs a board with color to move. Returns 0, leaving gs alone, if a square that holds
+// state bits is empty: a move there could not be told from them.
+int gs_from_board(GameState* gs, int board[8][8], int color);
+void gs_to_board(const GameState* gs, int board[8][8]);
+void gs_to_position(const GameState* gs, Position* pos);
+// As gs_from_board.
+int gs_from_position(GameState* gs, const Position* pos);
+// Plays sq for the side to move; 0 if it is not legal.
+int gs_play(GameState* gs, int sq);
+// Hands the turn over when the side to move has no move; 0 if it has one.
+int gs_pass(GameState* gs);
+int gs_count(const GameState* gs, int color);
+
+#endif
@@ -1,7 +1,11 @@
 ﻿#include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "board.h"
+#include "book.h"
 #include "computer.h"
+#include "eval.h"
+#include "gamestate.h"
 
 static void print_menu() {
     printf("オセロ：人間 vs コンピュータ\n");
@@ -9,16 +13,27 @@ static void print_menu() {
     printf("1. ランダム\n");
     printf("2. 最大取得\n");
     printf("3. 重み評価\n");
-    printf("番号を入力してください（1~3）: ");
+    printf("4. 探索\n");
+    printf("5. モンテカルロ木探索\n");
+    printf("番号を入力してください（1~5）: ");
 }
 
-int main() {
-    int board[8][8];
-    int turn = BLACK;  // 黒（人間）先手
+int main(int argc, char** argv) {
+    int board[8][8];   // 表示用
+    GameState game;    // 黒（人間）先手
     Strategy strategy;
+    SearchLimits limits;
+    ComputerContext ctx;
     int input;
 
-    init_board(board);
+    // 乱数シード（引数で指定すると同じ手順を再現できる）
+    computer_init(&ctx, argc > 1 ? strtoull(argv[1], NULL, 10) : (uint64_t)time(NULL));
+    // 定石ファイルがあれば序盤はそこから打つ
+    set_book(BOOK_DEFAULT_FILE);
+    // 調整済みの評価値ファイルがあれば使う
+    set_weights(EVAL_DEFAULT_FILE);
+    gs_init(&game);
+    gs_to_board(&game, board);
     print_board(board);
 
     // 戦略選択
@@ -34,52 +49,61 @@ int main() {
     case 3:
         strategy = WEIGHTED;
         break;
+    case 4:
+        strategy = SEARCH;
+        break;
+    case 5:
+        strategy = MCTS;
+        break;
     default:
         printf("無効な入力です。ランダムに設定します。\n");
         strategy = RANDOM; 
         break;
     }
+    search_limits_init(&limits, strategy);
 
-    while (!is_game_over(board)) {
+    // 終局判定と合法手は GameState に保持されている
+    while (!gs_is_over(&game)) {
+        int turn = gs_color(&game);
+        Position pos;
         printf("\n現在の手番: %s\n", (turn == BLACK) ? "人間（黒）" : "コンピュータ（白）");
 
-        if (has_valid_move(board, turn)) {
-            int row, col;
+        if (gs_moves(&game)) {
+            gs_to_position(&game, &pos);
             if (turn == BLACK) {
-                // 人間の入力
+                // 人間の入力（その間コンピュータは次の手を先読みする）
+                int row = -1, col = -1;
+                computer_ponder(&ctx, &pos, &limits);
                 printf("行（0~7）を入力: ");
                 scanf_s("%d", &row);
                 printf("列（0~7）を入力: ");
                 scanf_s("%d", &col);
-                if (is_valid_move(board, row, col, turn)) {
-                    apply_move(board, row, col, turn);
-                }
-                else {
+                if (row < 0 || row > 7 || col < 0 || col > 7 || !gs_play(&game, SQ(row, col))) {
                     printf("無効な手です。もう一度。\n");
                     continue;
                 }
             }
             else {
                 // コンピュータの手
-                get_computer_move(board, turn, &row, &col, strategy);
-                if (row != -1 && col != -1) {
-                    printf("コンピュータが (%d, %d) に置きます。\n", row, col);
-                    apply_move(board, row, col, turn);
-                }
+                int sq = computer_move(&ctx, &pos, &limits);
+                printf("コンピュータが (%d, %d) に置きます。\n", sq / 8, sq % 8);
+                gs_play(&game, sq);
             }
+            gs_to_board(&game, board);
             print_board(board);
         }
         else {
+            // 手番交代はパスで行う
             printf("合法手がありません。スキップします。\n");
+            gs_pass(&game);
         }
-
-        // ターン交代
-        turn = (turn == BLACK) ? WHITE : BLACK;
     }
 
+    computer_free(&ctx);
+
     // 結果表示
-    int black_score = count_stones(board, BLACK);
-    int white_score = count_stones(board, WHITE);
+    int black_score = gs_count(&game, BLACK);
+    int white_score = gs_count(&game, WHITE);
     printf("ゲーム終了\n");
     printf("黒: %d, 白: %d\n", black_score, white_score);
     if (black_score > white_score) {
@@ -0,0 +1,406 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mcts.h"
+#include "nn.h"
+#include "platform.h"
+#include "rng.h"
+
+#define MCTS_MAX_THREADS 64
+#define MAX_PATH 128
+#define EXPANDING (-1)
+// UCT exploration constant, for log2 rather than the natural log.
+#define EXPLORATION 0.5f
+// A leaf is expanded on its second visit, which keeps nodes that only ever saw one
+// playout out of the pools.
+#define EXPAND_VISITS 2
+// Playouts between clock and stop checks.
+#define CHECK_INTERVAL 32
+// With the network, leaves each worker keeps queued for scoring before it waits for the
+// oldest, and the score that counts as a certain win, in evaluation units.
+#define MCTS_IN_FLIGHT 16
+#define NETWORK_SCALE 256
+
+// A leaf queued for the network, with the path to back its result up.
+typedef struct {
+    NnRequest request;
+    int len;
+    int32_t path[MAX_PATH];
+} Pending;
+
+typedef struct {
+    MctsTree* tree;
+    Rng rng;
+    int64_t deadline;
+    uint64_t max_playouts;      // this worker's share, 0 = no limit
+    const volatile int* halt;   // the caller's stop flag, may be NULL
+    volatile int* stop;
+    uint64_t playouts;
+    int max_depth;
+    NnQueue* queue;             // NULL for random playouts
+    Pending* pending;           // MCTS_IN_FLIGHT of them when there is a queue
+    int pending_first, pending_count;
+    Thread thread;
+} Worker;
+
+// UCT needs log and sqrt only roughly, and these keep libm out of every program that
+// links the engine: the float's exponent and mantissa read as a piecewise-linear log2,
+// and a halved exponent plus one Newton step for the square root (within 0.1%).
+static inline float approx_log2(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return (float)bits * (1.0f / (1 << 23)) - 127.0f;
+}
+
+static inline float approx_sqrt(float x) {
+    uint32_t bits;
+    float y;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = (bits >> 1) + 0x1fbd1df5;
+    memcpy(&y, &bits, sizeof(y));
+    return 0.5f * (y + x / y);
+}
+
+static inline void play(uint64_t* own, uint64_t* opp, int move) {
+    uint64_t t = *own;
+    if (move != MCTS_PASS) {
+        uint64_t flipped = bb_flips(*own, *opp, move);
+        t |= flipped | SQ_BIT(move);
+        *own = *opp ^ flipped;
+    }
+    else {
+        *own = *opp;
+    }
+    *opp = t;
+}
+
+// Random moves to the end of the game: 2 if the side to move at the start wins, 1 for a
+// draw, 0 for a loss.
+static int playout(Rng* rng, uint64_t own, uint64_t opp) {
+    int parity = 0;     // 1 while the other side is to move
+    int passed = 0;
+
+    for (;;) {
+        uint64_t moves = bb_moves(own, opp);
+        if (!moves) {
+            if (passed) break;
+            passed = 1;
+        }
+        else {
+            passed = 0;
+            for (int i = (int)rng_below(rng, (uint32_t)bb_count(moves)); i > 0; i--) moves &= moves - 1;
+            int sq = bb_first(moves);
+            uint64_t flipped = bb_flips(own, opp, sq);
+            uint64_t t = own | flipped | SQ_BIT(sq);
+            own = opp ^ flipped;
+            opp = t;
+            parity ^= 1;
+            continue;
+        }
+        uint64_t t = own;
+        own = opp;
+        opp = t;
+        parity ^= 1;
+    }
+    int diff = bb_count(own) - bb_count(opp);
+    if (parity) diff = -diff;
+    return diff > 0 ? 2 : diff < 0 ? 0 : 1;
+}
+
+// Gives node its children unless another thread is at it, the game is over there or the
+// pool is full; returns the first child's index or 0.
+static int32_t expand(MctsTree* tree, MctsNode* node, uint64_t own, uint64_t opp) {
+    MctsNode* nodes = tree->pool[tree->current];
+    uint64_t moves = bb_moves(own, opp);
+    int count = moves ? bb_count(moves) : bb_moves(opp, own) ? 1 : 0;
+
+    if (!count || tree->used >= tree->capacity || !atomic_cas32(&node->first_child, 0, EXPANDING)) return 0;
+    int32_t first = atomic_add32(&tree->used, count) - count;
+    if (first + count > tree->capacity) {
+        atomic_cas32(&node->first_child, EXPANDING, 0);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        MctsNode* child = &nodes[first + i];
+        child->first_child = 0;
+        child->visits = 0;
+        child->points = 0;
+        child->move = (uint8_t)(moves ? bb_first(moves) : MCTS_PASS);
+        child->child_count = 0;
+        child->reserved = 0;
+        moves &= moves - 1;
+    }
+    node->child_count = (uint8_t)count;
+    atomic_cas32(&node->first_child, EXPANDING, first);
+    return first;
+}
+
+// The child with the best upper confidence bound. Unvisited children come first; visits
+// still in flight count as losses, so threads passing the same node spread out.
+static int32_t select_child(const MctsNode* nodes, const MctsNode* node, int32_t first) {
+    float log_visits = approx_log2((float)node->visits + 1.0f);
+    int32_t best = first;
+    float best_value = -1.0f;
+
+    for (int32_t c = first; c < first + node->child_count; c++) {
+        int32_t visits = nodes[c].visits;
+        if (visits == 0) return c;
+        float value = (float)nodes[c].points / (float)(2 * visits)
+            + EXPLORATION * approx_sqrt(log_visits / (float)visits);
+        if (value > best_value) {
+            best_value = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+// Selection and expansion from the root, counting a visit on every node passed; leaves
+// own/opp at the leaf and returns the length of path.
+static int descend(Worker* w, int32_t* path, uint64_t* own, uint64_t* opp) {
+    MctsTree* tree = w->tree;
+    MctsNode* nodes = tree->pool[tree->current];
+    int len = 0;
+    int32_t i = 0;
+
+    *own = tree->own;
+    *opp = tree->opp;
+    atomic_add32(&nodes[0].visits, 1);
+    path[len++] = 0;
+    while (len < MAX_PATH) {
+        int32_t first = atomic_load32(&nodes[i].first_child);
+        if (first == 0 && nodes[i].visits >= EXPAND_VISITS) first = expand(tree, &nodes[i], *own, *opp);
+        if (first <= 0) break;
+        i = select_child(nodes, &nodes[i], first);
+        atomic_add32(&nodes[i].visits, 1);
+        play(own, opp, nodes[i].move);
+        path[len++] = i;
+    }
+    if (len - 1 > w->max_depth) w->max_depth = len - 1;
+    return len;
+}
+
+// result is for the side to move at the leaf, and alternates up to the root's children.
+static void back_up(Worker* w, const int32_t* path, int len, int result) {
+    MctsNode* nodes = w->tree->pool[w->tree->current];
+
+    for (int k = len - 1; k > 0; k--) {
+        result = 2 - result;
+        atomic_add32(&nodes[path[k]].points, result);
+    }
+    w->playouts++;
+}
+
+// One selection, expansion, playout and update.
+static void run_playout(Worker* w) {
+    int32_t path[MAX_PATH];
+    uint64_t own, opp;
+    int len = descend(w, path, &own, &opp);
+
+    back_up(w, path, len, playout(&w->rng, own, opp));
+}
+
+// A network score as a playout result: 0 to 2 in proportion across +-NETWORK_SCALE,
+// rounded at random so that the points add up to the expected value.
+static int score_result(Rng* rng, int score) {
+    int x = score + NETWORK_SCALE;
+    if (x <= 0) return 0;
+    if (x >= 2 * NETWORK_SCALE) return 2;
+    return x / NETWORK_SCALE + (rng_below(rng, NETWORK_SCALE) < (uint32_t)(x % NETWORK_SCALE));
+}
+
+static void finish_oldest(Worker* w) {
+    Pending* p = &w->pending[w->pending_first];
+    int score = nn_queue_wait(w->queue, &p->request);
+
+    back_up(w, p->path, p->len, score_result(&w->rng, score));
+    w->pending_first = (w->pending_first + 1) % MCTS_IN_FLIGHT;
+    w->pending_count--;
+}
+
+// As run_playout, with the leaf queued for the network instead of played out, unless the
+// game is over there. The result comes back later; until then the path's visits count
+// against it as for any playout in flight.
+static void run_network(Worker* w) {
+    Pending* p = &w->pending[(w->pending_first + w->pending_count) % MCTS_IN_FLIGHT];
+    uint64_t own, opp;
+
+    p->len = descend(w, p->path, &own, &opp);
+    if (!bb_moves(own, opp) && !bb_moves(opp, own)) {
+        int diff = bb_count(own) - bb_count(opp);
+        back_up(w, p->path, p->len, diff > 0 ? 2 : diff < 0 ? 0 : 1);
+        return;
+    }
+    p->request.own = own;
+    p->request.opp = opp;
+    nn_queue_submit(w->queue, &p->request);
+    if (++w->pending_count == MCTS_IN_FLIGHT) finish_oldest(w);
+}
+
+static void worker_main(void* arg) {
+    Worker* w = arg;
+
+    while (!*w->stop) {
+        for (int i = 0; i < CHECK_INTERVAL; i++) {
+            if (w->queue) run_network(w);
+            else run_playout(w);
+        }
+        if (now_ms() >= w->deadline || (w->max_playouts && w->playouts >= w->max_playouts) || (w->halt && *w->halt))
+            *w->stop = 1;
+    }
+    // Nothing may stay in flight: the tree is kept for the next move.
+    while (w->queue && w->pending_count) finish_oldest(w);
+}
+
+// Index of the node for own/opp at the root or up to two plies below it, or -1.
+static int32_t find_node(const MctsTree* tree, uint64_t own, uint64_t opp) {
+    const MctsNode* nodes = tree->pool[tree->current];
+    int32_t first = nodes[0].first_child;
+
+    if (tree->own == own && tree->opp == opp) return 0;
+    for (int32_t c = first; first > 0 && c < first + nodes[0].child_count; c++) {
+        uint64_t a = tree->own, b = tree->opp;
+        play(&a, &b, nodes[c].move);
+        if (a == own && b == opp) return c;
+        int32_t grand = nodes[c].first_child;
+        for (int32_t g = grand; grand > 0 && g < grand + nodes[c].child_count; g++) {
+            uint64_t x = a, y = b;
+            play(&x, &y, nodes[g].move);
+            if (x == own && y == opp) return g;
+        }
+    }
+    return -1;
+}
+
+// Copies the subtree under index into the other pool, breadth first, with the copy
+// itself as the queue; returns the nodes kept.
+static int32_t keep_subtree(MctsTree* tree, int32_t index) {
+    const MctsNode* from = tree->pool[tree->current];
+    MctsNode* to = tree->pool[tree->current ^ 1];
+    int32_t used = 1;
+
+    to[0] = from[index];
+    for (int32_t scan = 0; scan < used; scan++) {
+        int32_t first = to[scan].first_child;
+        if (first <= 0) continue;
+        memcpy(&to[used], &from[first], to[scan].child_count * sizeof(MctsNode));
+        to[scan].first_child = used;
+        used += to[scan].child_count;
+    }
+    tree->current ^= 1;
+    tree->used = used;
+    return used;
+}
+
+static void reset(MctsTree* tree, uint64_t own, uint64_t opp) {
+    MctsNode* root = &tree->pool[tree->current][0];
+
+    memset(root, 0, sizeof(*root));
+    tree->used = 1;
+    tree->own = own;
+    tree->opp = opp;
+}
+
+void mcts_init(MctsTree* tree) {
+    memset(tree, 0, sizeof(*tree));
+}
+
+void mcts_free(MctsTree* tree) {
+    aligned_free(tree->pool[0]);
+    aligned_free(tree->pool[1]);
+    memset(tree, 0, sizeof(*tree));
+}
+
+static int allocate(MctsTree* tree, size_t mb) {
+    size_t count = mb * 1024 * 1024 / 2 / sizeof(MctsNode);
+
+    if (count < 64) count = 64;
+    if (count > INT32_MAX / 2) count = INT32_MAX / 2;
+    tree->pool[0] = aligned_malloc(count * sizeof(MctsNode), 64);
+    tree->pool[1] = aligned_malloc(count * sizeof(MctsNode), 64);
+    if (!tree->pool[0] || !tree->pool[1]) {
+        mcts_free(tree);
+        return 0;
+    }
+    tree->capacity = (int32_t)count;
+    tree->current = 0;
+    reset(tree, 0, 0);
+    return 1;
+}
+
+void mcts_search(MctsTree* tree, const Position* pos, const MctsParams* params, MctsResult* result) {
+    Worker workers[MCTS_MAX_THREADS];
+    volatile int stop = 0;
+    int64_t start = now_ms();
+    STAT_START(start_ticks);
+    uint64_t moves = bb_moves(pos->own, pos->opp);
+    int threads = params->threads < 1 ? 1 : params->threads > MCTS_MAX_THREADS ? MCTS_MAX_THREADS : params->threads;
+    uint64_t max_playouts = params->playouts;
+    NnQueue queue;
+    Pending* pending = NULL;
+    Rng rng;
+
+    memset(result, 0, sizeof(*result));
+    result->move = moves ? bb_first(moves) : -1;
+    if (!moves || (bb_count(moves) == 1 && params->time_ms > 0)) return;
+    if (!tree->capacity && !allocate(tree, params->memory_mb ? params->memory_mb : MCTS_DEFAULT_MB)) return;
+    if (!params->time_ms && !max_playouts) max_playouts = MCTS_DEFAULT_PLAYOUTS;
+
+    int32_t found = find_node(tree, pos->own, pos->opp);
+    if (found > 0) result->reused = keep_subtree(tree, found);
+    else if (found == 0) result->reused = tree->used;
+    else reset(tree, pos->own, pos->opp);
+    tree->own = pos->own;
+    tree->opp = pos->opp;
+    MctsNode* nodes = tree->pool[tree->current];
+    if (nodes[0].first_child <= 0) expand(tree, &nodes[0], pos->own, pos->opp);
+
+    // Every worker's leaves go through one queue, in batches as large as they can fill.
+    // Short of memory the search falls back to playouts.
+    int network = params->evaluator == EVAL_NETWORK;
+    if (network && (pending = malloc((size_t)threads * MCTS_IN_FLIGHT * sizeof(Pending))) != NULL)
+        nn_queue_init(&queue, threads * MCTS_IN_FLIGHT);
+    else network = 0;
+
+    rng_seed(&rng, params->seed);
+    for (int i = 0; i < threads; i++) {
+        Worker* w = &workers[i];
+        w->tree = tree;
+        rng_seed(&w->rng, rng_next(&rng));
+        w->deadline = params->time_ms > 0 ? start + params->time_ms : INT64_MAX / 2;
+        w->max_playouts = max_playouts ? max_playouts / (uint64_t)threads + 1 : 0;
+        w->halt = params->stop;
+        w->stop = &stop;
+        w->playouts = 0;
+        w->max_depth = 0;
+        w->queue = network ? &queue : NULL;
+        w->pending = network ? pending + (size_t)i * MCTS_IN_FLIGHT : NULL;
+        w->pending_first = w->pending_count = 0;
+    }
+    for (int i = 1; i < threads; i++)
+        if (!thread_start(&workers[i].thread, worker_main, &workers[i])) threads = i;
+    worker_main(&workers[0]);
+    for (int i = 1; i < threads; i++) thread_join(&workers[i].thread);
+    if (network) {
+        nn_queue_destroy(&queue);
+        free(pending);
+    }
+
+    // The most visited move is the one the search trusts most.
+    int32_t first = nodes[0].first_child;
+    int32_t best = -1;
+    for (int32_t c = first; first > 0 && c < first + nodes[0].child_count; c++)
+        if (best < 0 || nodes[c].visits > nodes[best].visits) best = c;
+    if (best >= 0) {
+        result->move = nodes[best].move;
+        result->win_rate = nodes[best].visits ? nodes[best].points / (2.0 * nodes[best].visits) : 0.0;
+    }
+    for (int i = 0; i < threads; i++) {
+        result->playouts += workers[i].playouts;
+        if (workers[i].max_depth > result->stats.depth) result->stats.depth = workers[i].max_depth;
+    }
+    result->tree_nodes = tree->used < tree->capacity ? tree->used : tree->capacity;
+    result->time_ms = now_ms() - start;
+    result->stats.nodes = result->playouts;
+    result->stats.time_ms = result->time_ms;
+    STAT_ELAPSED(&result->stats, ticks, start_ticks);
+}
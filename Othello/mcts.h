@@ -0,0 +1,68 @@
+#pragma once
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdint.h>
+#include "bitboard.h"
+#include "eval.h"
+#include "stats.h"
+
+#define MCTS_DEFAULT_MB 32
+#define MCTS_DEFAULT_PLAYOUTS 100000
+#define MCTS_PASS 64
+
+// 16 bytes. A node's children are allocated together, so it needs only the index of the
+// first; index 0 is the root, which is nobody's child.
+typedef struct {
+    volatile int32_t first_child;   // 0 = not expanded, -1 while a thread expands it
+    volatile int32_t visits;        // playouts through the node, those in flight included
+    volatile int32_t points;        // 2 per win and 1 per draw for the player who moved here
+    uint8_t move;                   // square played to get here, MCTS_PASS for a pass
+    uint8_t child_count;
+    uint16_t reserved;
+} MctsNode;
+
+// A tree kept from move to move of a game. Nodes come from two fixed pools instead of
+// the heap: moving the root copies the part of the tree still reachable into the other
+// pool, and everything else goes at no cost.
+typedef struct {
+    MctsNode* pool[2];
+    int32_t capacity;           // nodes per pool, 0 until first used
+    int current;                // pool holding the tree
+    volatile int32_t used;      // nodes taken from it, possibly past capacity
+    uint64_t own, opp;          // root position, from its side to move
+} MctsTree;
+
+typedef struct {
+    int time_ms;                // 0 = no limit
+    uint64_t playouts;          // stop after about this many, 0 = no limit
+    const volatile int* stop;   // set non-zero from another thread to stop early; may be NULL
+    int threads;
+    size_t memory_mb;           // both pools together, used when the tree is first allocated
+    uint64_t seed;              // for the playouts; reproducible with one thread and no time_ms
+    Evaluator evaluator;        // EVAL_NETWORK scores leaves with the network, see mcts_search
+} MctsParams;
+
+typedef struct {
+    int move;                   // most visited root move, -1 when there is no legal move
+    double win_rate;            // of that move for the side to move, draws counting half
+    uint64_t playouts;
+    int32_t reused;             // nodes kept from the previous move's tree
+    int32_t tree_nodes;         // nodes in the tree at the end
+    int64_t time_ms;
+    SearchStats stats;          // nodes = playouts, depth = deepest selection
+} MctsResult;
+
+void mcts_init(MctsTree* tree);
+void mcts_free(MctsTree* tree);
+
+// Upper-confidence tree search from pos with random playouts, on params->threads threads
+// sharing one tree; a virtual loss on every node a playout passes steers the threads
+// apart. If pos is the root of the tree or up to two plies below it, that subtree is kept.
+// With a time limit a forced move is played at once. With no limits at all it stops after
+// MCTS_DEFAULT_PLAYOUTS. With EVAL_NETWORK the network's score of each leaf takes the
+// place of its playout: every thread keeps a few leaves queued and goes on selecting
+// while they are scored in batches, and the results are counted as playouts.
+void mcts_search(MctsTree* tree, const Position* pos, const MctsParams* params, MctsResult* result);
+
+#endif
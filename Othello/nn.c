@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitboard.h"
+#include "eval.h"
+#include "nn.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NN_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define NN_AVX2 0
+#endif
+
+// The default network's first layer: unit 0 is the piece-square sum weights[8][8] gives
+// the side to move, scaled by DEFAULT_SCALE and centred by DEFAULT_BIAS, unit 1 the same
+// for the opponent; linear for sums within about +-500.
+#define DEFAULT_SCALE 8
+#define DEFAULT_BIAS (64 * 127 / 2)
+
+static const char nn_magic[8] = { 'O', 'T', 'H', 'N', 'N', 'W', '0', '1' };
+
+static NnWeights net;
+static Once net_once = ONCE_INIT;
+static int use_avx2;
+
+// Only ever run once, and every reader goes through nn_init first, so nobody sees the
+// network half built.
+static void build_default(void) {
+    memset(&net, 0, sizeof(net));
+    for (int sq = 0; sq < 64; sq++) {
+        int16_t w = (int16_t)(DEFAULT_SCALE * weights[sq / 8][sq % 8]);
+        net.w1[sq][0] = w;
+        net.w1[64 + sq][0] = (int16_t)-w;
+        net.w1[sq][1] = (int16_t)-w;
+        net.w1[64 + sq][1] = w;
+    }
+    net.b1[0] = net.b1[1] = DEFAULT_BIAS;
+    // Layer 2 passes both units through; layer 3 takes their difference.
+    net.w2[0][0] = net.w2[1][1] = 1 << NN_SHIFT;
+    net.w3[0] = (int8_t)(4 << NN_OUTPUT_SHIFT);
+    net.w3[1] = (int8_t)-(4 << NN_OUTPUT_SHIFT);
+    use_avx2 = bb_has_avx2();
+}
+
+void nn_init(void) {
+    run_once(&net_once, build_default);
+}
+
+static inline int clip(int x) {
+    return x < 0 ? 0 : x > 127 ? 127 : x;
+}
+
+static int forward_scalar(uint64_t own, uint64_t opp) {
+    int16_t acc[NN_HIDDEN];
+    uint8_t h1[NN_HIDDEN];
+    int h2[NN_HIDDEN];
+
+    memcpy(acc, net.b1, sizeof(acc));
+    for (; own; own &= own - 1) {
+        const int16_t* row = net.w1[bb_first(own)];
+        for (int i = 0; i < NN_HIDDEN; i++) acc[i] = (int16_t)(acc[i] + row[i]);
+    }
+    for (; opp; opp &= opp - 1) {
+        const int16_t* row = net.w1[64 + bb_first(opp)];
+        for (int i = 0; i < NN_HIDDEN; i++) acc[i] = (int16_t)(acc[i] + row[i]);
+    }
+    for (int i = 0; i < NN_HIDDEN; i++) h1[i] = (uint8_t)clip(acc[i] >> NN_SHIFT);
+
+    for (int j = 0; j < NN_HIDDEN; j++) {
+        int32_t sum = net.b2[j];
+        for (int i = 0; i < NN_HIDDEN; i++) sum += h1[i] * net.w2[j][i];
+        h2[j] = clip(sum >> NN_SHIFT);
+    }
+    int32_t out = net.b3;
+    for (int i = 0; i < NN_HIDDEN; i++) out += h2[i] * net.w3[i];
+    return out >> NN_OUTPUT_SHIFT;
+}
+
+#if NN_AVX2
+// The sums of eight vectors of eight int32, in order.
+static inline TARGET_AVX2 __m256i sum8(const __m256i* v) {
+    __m256i a = _mm256_hadd_epi32(_mm256_hadd_epi32(v[0], v[1]), _mm256_hadd_epi32(v[2], v[3]));
+    __m256i b = _mm256_hadd_epi32(_mm256_hadd_epi32(v[4], v[5]), _mm256_hadd_epi32(v[6], v[7]));
+    return _mm256_add_epi32(_mm256_permute2x128_si256(a, b, 0x20), _mm256_permute2x128_si256(a, b, 0x31));
+}
+
+// Layer 1 holds 32 int16 in two registers. Packing them to bytes saturates to -128..127,
+// which after the max with zero is the same clip as the scalar kernel's; the pack works per
+// 128-bit lane, so the 64-bit quarters are put back in order before the dot products.
+static TARGET_AVX2 int forward_avx2(uint64_t own, uint64_t opp) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i top = _mm256_set1_epi32(127);
+    __m256i lo = _mm256_loadu_si256((const __m256i*)&net.b1[0]);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)&net.b1[16]);
+
+    for (; own; own &= own - 1) {
+        const int16_t* row = net.w1[bb_first(own)];
+        lo = _mm256_add_epi16(lo, _mm256_loadu_si256((const __m256i*)&row[0]));
+        hi = _mm256_add_epi16(hi, _mm256_loadu_si256((const __m256i*)&row[16]));
+    }
+    for (; opp; opp &= opp - 1) {
+        const int16_t* row = net.w1[64 + bb_first(opp)];
+        lo = _mm256_add_epi16(lo, _mm256_loadu_si256((const __m256i*)&row[0]));
+        hi = _mm256_add_epi16(hi, _mm256_loadu_si256((const __m256i*)&row[16]));
+    }
+    __m256i h1 = _mm256_packs_epi16(_mm256_srai_epi16(lo, NN_SHIFT), _mm256_srai_epi16(hi, NN_SHIFT));
+    h1 = _mm256_max_epi8(_mm256_permute4x64_epi64(h1, 0xd8), zero);
+
+    __m256i out = zero;
+    for (int j = 0; j < NN_HIDDEN; j += 8) {
+        __m256i dots[8];
+        for (int k = 0; k < 8; k++) {
+            __m256i w = _mm256_loadu_si256((const __m256i*)net.w2[j + k]);
+            dots[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(h1, w), ones);
+        }
+        __m256i sum = _mm256_add_epi32(sum8(dots), _mm256_loadu_si256((const __m256i*)&net.b2[j]));
+        __m256i h2 = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(sum, NN_SHIFT), zero), top);
+        __m256i w3 = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)&net.w3[j]));
+        out = _mm256_add_epi32(out, _mm256_mullo_epi32(h2, w3));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(out), _mm256_extracti128_si256(out, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return (net.b3 + _mm_cvtsi128_si32(s)) >> NN_OUTPUT_SHIFT;
+}
+
+static TARGET_AVX2 void batch_avx2(const uint64_t* own, const uint64_t* opp, int n, int* scores) {
+    for (int i = 0; i < n; i++) scores[i] = forward_avx2(own[i], opp[i]);
+}
+#endif
+
+void nn_evaluate_batch_scalar(const uint64_t* own, const uint64_t* opp, int n, int* scores) {
+    nn_init();
+    for (int i = 0; i < n; i++) scores[i] = forward_scalar(own[i], opp[i]);
+}
+
+void nn_evaluate_batch(const uint64_t* own, const uint64_t* opp, int n, int* scores) {
+    nn_init();
+#if NN_AVX2
+    if (use_avx2) {
+        for (int base = 0; base < n; base += NN_MAX_BATCH)
+            batch_avx2(own + base, opp + base, n - base < NN_MAX_BATCH ? n - base : NN_MAX_BATCH, scores + base);
+        return;
+    }
+#endif
+    nn_evaluate_batch_scalar(own, opp, n, scores);
+}
+
+int nn_evaluate(uint64_t own, uint64_t opp) {
+    int score;
+    nn_evaluate_batch(&own, &opp, 1, &score);
+    return score;
+}
+
+int nn_save(const char* path) {
+    FILE* fp = fopen(path, "wb");
+
+    if (!fp) return 0;
+    nn_init();
+    int ok = fwrite(nn_magic, sizeof(nn_magic), 1, fp) == 1
+        && write_le(fp, net.w1, sizeof(int16_t), NN_INPUTS * NN_HIDDEN) && write_le(fp, net.b1, sizeof(int16_t), NN_HIDDEN)
+        && write_le(fp, net.w2, sizeof(int8_t), NN_HIDDEN * NN_HIDDEN) && write_le(fp, net.b2, sizeof(int32_t), NN_HIDDEN)
+        && write_le(fp, net.w3, sizeof(int8_t), NN_HIDDEN) && write_le(fp, &net.b3, sizeof(int32_t), 1);
+    return fclose(fp) == 0 && ok;
+}
+
+int nn_load(const char* path) {
+    static NnWeights file;
+    char magic[sizeof(nn_magic)];
+    FILE* fp = fopen(path, "rb");
+
+    if (!fp) return 0;
+    int ok = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, nn_magic, sizeof(magic)) == 0
+        && read_le(fp, file.w1, sizeof(int16_t), NN_INPUTS * NN_HIDDEN) && read_le(fp, file.b1, sizeof(int16_t), NN_HIDDEN)
+        && read_le(fp, file.w2, sizeof(int8_t), NN_HIDDEN * NN_HIDDEN) && read_le(fp, file.b2, sizeof(int32_t), NN_HIDDEN)
+        && read_le(fp, file.w3, sizeof(int8_t), NN_HIDDEN) && read_le(fp, &file.b3, sizeof(int32_t), 1)
+        && fgetc(fp) == EOF;
+    fclose(fp);
+    if (!ok) return 0;
+
+    nn_init();
+    net = file;
+    return 1;
+}
+
+void nn_queue_init(NnQueue* q, int batch_size) {
+    memset(q, 0, sizeof(*q));
+    q->batch_size = batch_size < 1 ? 1 : batch_size > NN_MAX_BATCH ? NN_MAX_BATCH : batch_size;
+    mutex_init(&q->lock);
+    cond_init(&q->done);
+    nn_init();
+}
+
+void nn_queue_destroy(NnQueue* q) {
+    cond_destroy(&q->done);
+    mutex_destroy(&q->lock);
+}
+
+// Takes everything queued but not yet claimed, at most a batch and at least one, scores it
+// and publishes the results. Called and returns with the lock held, releasing it while the
+// kernel runs.
+static void run_batch(NnQueue* q) {
+    NnRequest* batch[NN_MAX_BATCH];
+    uint64_t own[NN_MAX_BATCH], opp[NN_MAX_BATCH];
+    int scores[NN_MAX_BATCH];
+    int n = 0;
+
+    do {
+        NnRequest* r = q->queued[q->claimed++ % NN_MAX_BATCH];
+        batch[n] = r;
+        own[n] = r->own;
+        opp[n++] = r->opp;
+    } while (q->claimed < q->submitted && n < q->batch_size);
+    mutex_unlock(&q->lock);
+    nn_evaluate_batch(own, opp, n, scores);
+    mutex_lock(&q->lock);
+    for (int i = 0; i < n; i++) {
+        batch[i]->score = scores[i];
+        batch[i]->done = 1;
+    }
+    cond_broadcast(&q->done);
+}
+
+void nn_queue_submit(NnQueue* q, NnRequest* request) {
+    mutex_lock(&q->lock);
+    request->done = 0;
+    request->ticket = q->submitted++;
+    q->queued[request->ticket % NN_MAX_BATCH] = request;
+    if (q->submitted - q->claimed >= (uint64_t)q->batch_size) run_batch(q);
+    mutex_unlock(&q->lock);
+}
+
+int nn_queue_poll(NnQueue* q, const NnRequest* request) {
+    mutex_lock(&q->lock);
+    int done = request->done;
+    mutex_unlock(&q->lock);
+    return done;
+}
+
+int nn_queue_wait(NnQueue* q, NnRequest* request) {
+    mutex_lock(&q->lock);
+    while (!request->done) {
+        if (request->ticket >= q->claimed) run_batch(q);
+        else cond_wait(&q->done, &q->lock);
+    }
+    mutex_unlock(&q->lock);
+    return request->score;
+}
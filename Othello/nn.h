@@ -0,0 +1,76 @@
+#pragma once
+#ifndef NN_H
+#define NN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+// A small quantised network over the discs alone. Layer 1 adds an int16 row per disc
+// (own discs are inputs 0-63, the opponent's 64-127) to its bias; layers 2 and 3 are int8
+// dot products over the outputs of the layer before, each clipped to 0..127 after a shift
+// of NN_SHIFT. The output, shifted by NN_OUTPUT_SHIFT, is in search units for the side to
+// move.
+#define NN_INPUTS 128
+#define NN_HIDDEN 32
+#define NN_SHIFT 6
+#define NN_OUTPUT_SHIFT 4
+#define NN_MAX_BATCH 256
+#define NN_DEFAULT_FILE "othello.nn"
+
+typedef struct {
+    int16_t w1[NN_INPUTS][NN_HIDDEN];
+    int16_t b1[NN_HIDDEN];
+    int8_t w2[NN_HIDDEN][NN_HIDDEN];    // [output][input]
+    int32_t b2[NN_HIDDEN];
+    int8_t w3[NN_HIDDEN];
+    int32_t b3;
+} NnWeights;
+
+// Sets the defaults, a piece-square network built from weights[8][8] that stands in until
+// a trained file is loaded, the first time it is called; safe from any number of threads
+// at once.
+void nn_init(void);
+
+// Writes the current network, or replaces it with a file written by nn_save: the magic
+// OTHNNW01 and then the fields of NnWeights in order, little-endian. A malformed file is
+// rejected and the network is left as it is. Loading is for program setup, while nothing
+// is evaluating.
+int nn_save(const char* path);
+int nn_load(const char* path);
+
+// Scores of n positions (side to move first) in batches of up to NN_MAX_BATCH, with AVX2
+// where the CPU has it; the scalar kernel gives the same results.
+void nn_evaluate_batch(const uint64_t* own, const uint64_t* opp, int n, int* scores);
+void nn_evaluate_batch_scalar(const uint64_t* own, const uint64_t* opp, int n, int* scores);
+int nn_evaluate(uint64_t own, uint64_t opp);
+
+// Collects positions from any number of threads and scores them together. Each caller
+// owns its requests: submit queues one and returns at once, the thread whose request fills
+// a batch of batch_size scores that batch, and a thread waiting on a request nobody has
+// taken yet scores whatever is queued, so results never wait for more positions to arrive.
+// A request must stay where it is until it has been waited on or polled as done.
+typedef struct {
+    uint64_t own, opp;          // side to move first, set by the caller
+    uint64_t ticket;            // set by nn_queue_submit
+    int score;                  // valid once done
+    int done;
+} NnRequest;
+
+typedef struct {
+    Mutex lock;
+    Cond done;
+    int batch_size;
+    uint64_t submitted;         // tickets handed out
+    uint64_t claimed;           // tickets taken for scoring; never more than a batch behind
+    NnRequest* queued[NN_MAX_BATCH];    // unclaimed requests, indexed by ticket
+} NnQueue;
+
+void nn_queue_init(NnQueue* q, int batch_size);
+void nn_queue_destroy(NnQueue* q);
+void nn_queue_submit(NnQueue* q, NnRequest* request);
+// Non-zero once request->score is in.
+int nn_queue_poll(NnQueue* q, const NnRequest* request);
+int nn_queue_wait(NnQueue* q, NnRequest* request);
+
+#endif
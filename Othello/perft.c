@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "board.h"
+#include "bitboard.h"
+#include "platform.h"
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: othello_perft <depth> [position]\n"
+        "  position: 64 squares row by row (X black, O white, - empty), then X or O to move;\n"
+        "            defaults to the start position\n");
+}
+
+int main(int argc, char** argv) {
+    int depth = argc > 1 ? atoi(argv[1]) : 0;
+    Position pos;
+    char text[67];
+
+    if (depth < 1 || argc > 3) {
+        usage();
+        return 1;
+    }
+    if (argc == 3) {
+        if (!bb_parse(argv[2], &pos)) {
+            usage();
+            return 1;
+        }
+    }
+    else {
+        int board[8][8];
+        init_board(board);
+        bb_from_board(board, BLACK, &pos);
+    }
+
+    bb_format(&pos, text);
+    printf("%s\n", text);
+
+    int64_t start = now_ms();
+    uint64_t total = 0;
+    uint64_t moves = bb_moves(pos.own, pos.opp);
+
+    if (!moves) {
+        total = bb_perft(&pos, depth);
+        printf("%s %llu\n", bb_moves(pos.opp, pos.own) ? "pass" : "game over", (unsigned long long)total);
+    }
+    for (; moves; moves &= moves - 1) {
+        int sq = bb_first(moves);
+        uint64_t nodes = 1;
+        Undo undo;
+
+        bb_make_move(&pos, sq, &undo);
+        if (depth > 1) nodes = bb_perft(&pos, depth - 1);
+        bb_undo_move(&pos, &undo);
+        printf("(%d, %d) %llu\n", sq / 8, sq % 8, (unsigned long long)nodes);
+        total += nodes;
+    }
+
+    int64_t elapsed = now_ms() - start;
+    printf("total %llu\n", (unsigned long long)total);
+    printf("%.2f s, %.0f nodes/s\n", elapsed / 1000.0, elapsed > 0 ? total * 1000.0 / elapsed : 0.0);
+    return 0;
+}
@@ -0,0 +1,359 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define HAVE_RDTSC 1
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <process.h>
+#include <windows.h>
+
+static void thread_yield(void) {
+    SwitchToThread();
+}
+
+int64_t now_ms(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart * 1000 / freq.QuadPart);
+}
+
+uint64_t now_ticks(void) {
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)counter.QuadPart;
+#endif
+}
+
+void* aligned_malloc(size_t size, size_t align) {
+    return _aligned_malloc(size, align);
+}
+
+void aligned_free(void* p) {
+    _aligned_free(p);
+}
+
+const void* map_file(const char* path, size_t* size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER length;
+    HANDLE mapping;
+    const void* p = NULL;
+
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && (uint64_t)length.QuadPart <= SIZE_MAX) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (p) *size = (size_t)length.QuadPart;
+    return p;
+}
+
+void unmap_file(const void* p, size_t size) {
+    (void)size;
+    UnmapViewOfFile(p);
+}
+
+int truncate_file(const char* path, uint64_t size) {
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER end;
+    int ok;
+
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    end.QuadPart = (LONGLONG)size;
+    ok = SetFilePointerEx(file, end, NULL, FILE_BEGIN) && SetEndOfFile(file);
+    CloseHandle(file);
+    return ok;
+}
+
+static unsigned __stdcall thread_main(void* p) {
+    Thread* t = p;
+    t->fn(t->arg);
+    return 0;
+}
+
+int thread_start(Thread* t, void (*fn)(void*), void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+    t->handle = (void*)_beginthreadex(NULL, 0, thread_main, t, 0, NULL);
+    return t->handle != NULL;
+}
+
+void thread_join(Thread* t) {
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+}
+
+void mutex_init(Mutex* m) {
+    m->impl = malloc(sizeof(CRITICAL_SECTION));
+    InitializeCriticalSection(m->impl);
+}
+
+void mutex_destroy(Mutex* m) {
+    DeleteCriticalSection(m->impl);
+    free(m->impl);
+}
+
+void mutex_lock(Mutex* m) {
+    EnterCriticalSection(m->impl);
+}
+
+void mutex_unlock(Mutex* m) {
+    LeaveCriticalSection(m->impl);
+}
+
+void cond_init(Cond* c) {
+    c->impl = malloc(sizeof(CONDITION_VARIABLE));
+    InitializeConditionVariable(c->impl);
+}
+
+void cond_destroy(Cond* c) {
+    free(c->impl);
+}
+
+void cond_wait(Cond* c, Mutex* m) {
+    SleepConditionVariableCS(c->impl, m->impl, INFINITE);
+}
+
+void cond_signal(Cond* c) {
+    WakeConditionVariable(c->impl);
+}
+
+void cond_broadcast(Cond* c) {
+    WakeAllConditionVariable(c->impl);
+}
+
+void rwlock_init(RwLock* l) {
+    l->impl = malloc(sizeof(SRWLOCK));
+    InitializeSRWLock(l->impl);
+}
+
+void rwlock_destroy(RwLock* l) {
+    free(l->impl);
+}
+
+void rwlock_read_lock(RwLock* l) {
+    AcquireSRWLockShared(l->impl);
+}
+
+void rwlock_read_unlock(RwLock* l) {
+    ReleaseSRWLockShared(l->impl);
+}
+
+void rwlock_write_lock(RwLock* l) {
+    AcquireSRWLockExclusive(l->impl);
+}
+
+void rwlock_write_unlock(RwLock* l) {
+    ReleaseSRWLockExclusive(l->impl);
+}
+
+#else
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void thread_yield(void) {
+    sched_yield();
+}
+
+int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t now_ticks(void) {
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void* aligned_malloc(size_t size, size_t align) {
+    void* p;
+    return posix_memalign(&p, align, size) == 0 ? p : NULL;
+}
+
+void aligned_free(void* p) {
+    free(p);
+}
+
+const void* map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    void* p = MAP_FAILED;
+
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+    *size = (size_t)st.st_size;
+    return p;
+}
+
+void unmap_file(const void* p, size_t size) {
+    munmap((void*)p, size);
+}
+
+int truncate_file(const char* path, uint64_t size) {
+    return truncate(path, (off_t)size) == 0;
+}
+
+static void* thread_main(void* p) {
+    Thread* t = p;
+    t->fn(t->arg);
+    return NULL;
+}
+
+int thread_start(Thread* t, void (*fn)(void*), void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+    return pthread_create(&t->handle, NULL, thread_main, t) == 0;
+}
+
+void thread_join(Thread* t) {
+    pthread_join(t->handle, NULL);
+}
+
+void mutex_init(Mutex* m) {
+    pthread_mutex_init(&m->impl, NULL);
+}
+
+void mutex_destroy(Mutex* m) {
+    pthread_mutex_destroy(&m->impl);
+}
+
+void mutex_lock(Mutex* m) {
+    pthread_mutex_lock(&m->impl);
+}
+
+void mutex_unlock(Mutex* m) {
+    pthread_mutex_unlock(&m->impl);
+}
+
+void cond_init(Cond* c) {
+    pthread_cond_init(&c->impl, NULL);
+}
+
+void cond_destroy(Cond* c) {
+    pthread_cond_destroy(&c->impl);
+}
+
+void cond_wait(Cond* c, Mutex* m) {
+    pthread_cond_wait(&c->impl, &m->impl);
+}
+
+void cond_signal(Cond* c) {
+    pthread_cond_signal(&c->impl);
+}
+
+void cond_broadcast(Cond* c) {
+    pthread_cond_broadcast(&c->impl);
+}
+
+void rwlock_init(RwLock* l) {
+    l->impl = malloc(sizeof(pthread_rwlock_t));
+    pthread_rwlock_init(l->impl, NULL);
+}
+
+void rwlock_destroy(RwLock* l) {
+    pthread_rwlock_destroy(l->impl);
+    free(l->impl);
+}
+
+void rwlock_read_lock(RwLock* l) {
+    pthread_rwlock_rdlock(l->impl);
+}
+
+void rwlock_read_unlock(RwLock* l) {
+    pthread_rwlock_unlock(l->impl);
+}
+
+void rwlock_write_lock(RwLock* l) {
+    pthread_rwlock_wrlock(l->impl);
+}
+
+void rwlock_write_unlock(RwLock* l) {
+    pthread_rwlock_unlock(l->impl);
+}
+
+#endif
+
+int write_le(FILE* fp, const void* values, size_t size, size_t count) {
+    const unsigned char* v = values;
+    unsigned char bytes[256 * 8];
+
+    while (count) {
+        size_t n = count < 256 ? count : 256;
+        for (size_t i = 0; i < n; i++, v += size) {
+            uint64_t x = 0;
+            if (size == 1) x = *v;
+            else if (size == 2) { uint16_t t; memcpy(&t, v, 2); x = t; }
+            else if (size == 4) { uint32_t t; memcpy(&t, v, 4); x = t; }
+            else memcpy(&x, v, 8);
+            for (size_t b = 0; b < size; b++) bytes[i * size + b] = (unsigned char)(x >> (8 * b));
+        }
+        if (fwrite(bytes, size, n, fp) != n) return 0;
+        count -= n;
+    }
+    return 1;
+}
+
+int read_le(FILE* fp, void* values, size_t size, size_t count) {
+    unsigned char* v = values;
+    unsigned char bytes[256 * 8];
+
+    while (count) {
+        size_t n = count < 256 ? count : 256;
+        if (fread(bytes, size, n, fp) != n) return 0;
+        for (size_t i = 0; i < n; i++, v += size) {
+            uint64_t x = 0;
+            for (size_t b = 0; b < size; b++) x |= (uint64_t)bytes[i * size + b] << (8 * b);
+            if (size == 1) *v = (unsigned char)x;
+            else if (size == 2) { uint16_t t = (uint16_t)x; memcpy(v, &t, 2); }
+            else if (size == 4) { uint32_t t = (uint32_t)x; memcpy(v, &t, 4); }
+            else memcpy(v, &x, 8);
+        }
+        count -= n;
+    }
+    return 1;
+}
+
+// The callers that lose the race only wait for a one-off table fill, so they yield
+// rather than sleep on a lock that would itself need initialising.
+void run_once_slow(Once* once, void (*fn)(void)) {
+    if (atomic_cas32(&once->state, 0, 1)) {
+        fn();
+        atomic_add32(&once->state, 1);
+        return;
+    }
+    while (atomic_load32(&once->state) != 2) thread_yield();
+}
@@ -0,0 +1,132 @@
+#pragma once
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <pthread.h>
+#endif
+
+// Monotonic wall clock in milliseconds.
+int64_t now_ms(void);
+// Cheap high-resolution counter in unspecified units (the CPU's time-stamp counter where
+// there is one), for comparing the cost of code paths rather than telling the time.
+uint64_t now_ticks(void);
+
+// Heap block aligned to align bytes (a power of two); release with aligned_free.
+void* aligned_malloc(size_t size, size_t align);
+void aligned_free(void* p);
+
+// Maps a whole file read-only and stores its length in size; NULL if it cannot be
+// opened or is empty. The pages are shared by every process mapping the same file.
+const void* map_file(const char* path, size_t* size);
+void unmap_file(const void* p, size_t size);
+// Cuts the file at path down to size bytes; 0 on failure.
+int truncate_file(const char* path, uint64_t size);
+// Writes or reads count integers of size bytes each (1, 2, 4 or 8) as little-endian,
+// whatever the host's byte order; 0 unless all of them got through.
+int write_le(FILE* fp, const void* values, size_t size, size_t count);
+int read_le(FILE* fp, void* values, size_t size, size_t count);
+
+typedef struct {
+#ifdef _WIN32
+    void* handle;
+#else
+    pthread_t handle;
+#endif
+    void (*fn)(void*);
+    void* arg;
+} Thread;
+
+// t must stay valid until thread_join returns.
+int thread_start(Thread* t, void (*fn)(void*), void* arg);
+void thread_join(Thread* t);
+
+typedef struct {
+#ifdef _WIN32
+    void* impl;     // CRITICAL_SECTION, allocated by mutex_init
+#else
+    pthread_mutex_t impl;
+#endif
+} Mutex;
+
+void mutex_init(Mutex* m);
+void mutex_destroy(Mutex* m);
+void mutex_lock(Mutex* m);
+void mutex_unlock(Mutex* m);
+
+typedef struct {
+#ifdef _WIN32
+    void* impl;     // CONDITION_VARIABLE, allocated by cond_init
+#else
+    pthread_cond_t impl;
+#endif
+} Cond;
+
+void cond_init(Cond* c);
+void cond_destroy(Cond* c);
+// Releases m while waiting; m is held again on return. Wake-ups may be spurious.
+void cond_wait(Cond* c, Mutex* m);
+void cond_signal(Cond* c);
+void cond_broadcast(Cond* c);
+
+// Atomic read-modify-write on 32-bit words shared between threads, each a full barrier.
+// atomic_add32 returns the new value; atomic_cas32 stores desired and returns non-zero
+// only if *p held expected. atomic_load32 sees at least what was written before a
+// barrier in the writing thread.
+#ifdef _WIN32
+static inline int32_t atomic_add32(volatile int32_t* p, int32_t n) {
+    return _InterlockedExchangeAdd((volatile long*)p, n) + n;
+}
+static inline int atomic_cas32(volatile int32_t* p, int32_t expected, int32_t desired) {
+    return _InterlockedCompareExchange((volatile long*)p, desired, expected) == expected;
+}
+static inline int32_t atomic_load32(const volatile int32_t* p) {
+    return *p;      // volatile reads acquire with MSVC's default /volatile:ms
+}
+#else
+static inline int32_t atomic_add32(volatile int32_t* p, int32_t n) {
+    return __atomic_add_fetch(p, n, __ATOMIC_SEQ_CST);
+}
+static inline int atomic_cas32(volatile int32_t* p, int32_t expected, int32_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+static inline int32_t atomic_load32(const volatile int32_t* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+#endif
+
+// Runs fn exactly once however many threads call run_once on the same Once at the same
+// time; none of them returns before fn has finished. A Once with static storage starts as
+// ONCE_INIT (all zero).
+typedef struct {
+    volatile int32_t state;     // 0 not run, 1 running, 2 done
+} Once;
+
+#define ONCE_INIT { 0 }
+
+void run_once_slow(Once* once, void (*fn)(void));
+
+// Inline, so that a call once fn has run costs one load.
+static inline void run_once(Once* once, void (*fn)(void)) {
+    if (atomic_load32(&once->state) != 2) run_once_slow(once, fn);
+}
+
+// Any number of readers or one writer. Not recursive, and a reader cannot upgrade.
+typedef struct {
+    void* impl;     // SRWLOCK or pthread_rwlock_t, allocated by rwlock_init
+} RwLock;
+
+void rwlock_init(RwLock* l);
+void rwlock_destroy(RwLock* l);
+void rwlock_read_lock(RwLock* l);
+void rwlock_read_unlock(RwLock* l);
+void rwlock_write_lock(RwLock* l);
+void rwlock_write_unlock(RwLock* l);
+
+#endif
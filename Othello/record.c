@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "record.h"
+
+static const char record_magic[8] = { 'O', 'T', 'H', 'R', 'E', 'C', '0', '1' };
+
+static void flush(RecordWriter* w) {
+    if (w->used && fwrite(w->buffer, 1, w->used, w->fp) != w->used) w->failed = 1;
+    w->used = 0;
+}
+
+RecordWriter* record_writer_open(const char* path) {
+    RecordWriter* w = malloc(sizeof(RecordWriter));
+
+    if (!w) return NULL;
+    w->fp = fopen(path, "wb");
+    if (!w->fp) {
+        free(w);
+        return NULL;
+    }
+    memcpy(w->buffer, record_magic, sizeof(record_magic));
+    w->used = sizeof(record_magic);
+    w->failed = 0;
+    return w;
+}
+
+void record_write(RecordWriter* w, const GameRecord* game) {
+    unsigned char* p;
+
+    if (w->used + RECORD_HEADER_SIZE + (size_t)game->plies > RECORD_BUFFER_SIZE) flush(w);
+    p = w->buffer + w->used;
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(game->seed >> (8 * i));
+    for (int i = 0; i < 4; i++) p[8 + i] = (unsigned char)(game->game >> (8 * i));
+    p[12] = (unsigned char)(game->strategy[0] | game->strategy[1] << 4);
+    p[13] = game->discs[0];
+    p[14] = game->discs[1];
+    p[15] = (unsigned char)game->plies;
+    memcpy(p + RECORD_HEADER_SIZE, game->moves, (size_t)game->plies);
+    w->used += RECORD_HEADER_SIZE + (size_t)game->plies;
+}
+
+int record_writer_close(RecordWriter* w) {
+    flush(w);
+    int ok = fclose(w->fp) == 0 && !w->failed;
+    free(w);
+    return ok;
+}
+
+// Makes at least n bytes available at r->buffer + r->pos unless the file ends first.
+static int fill(RecordReader* r, size_t n) {
+    if (r->len - r->pos >= n) return 1;
+    memmove(r->buffer, r->buffer + r->pos, r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+    r->len += fread(r->buffer + r->len, 1, RECORD_BUFFER_SIZE - r->len, r->fp);
+    return r->len >= n;
+}
+
+RecordReader* record_reader_open(const char* path) {
+    RecordReader* r = malloc(sizeof(RecordReader));
+
+    if (!r) return NULL;
+    r->fp = fopen(path, "rb");
+    r->pos = r->len = 0;
+    if (!r->fp || !fill(r, sizeof(record_magic)) || memcmp(r->buffer, record_magic, sizeof(record_magic)) != 0) {
+        if (r->fp) fclose(r->fp);
+        free(r);
+        return NULL;
+    }
+    r->pos = sizeof(record_magic);
+    return r;
+}
+
+int record_read(RecordReader* r, GameRecord* game) {
+    const unsigned char* p;
+
+    if (!fill(r, RECORD_HEADER_SIZE)) return 0;
+    p = r->buffer + r->pos;
+    game->seed = 0;
+    for (int i = 0; i < 8; i++) game->seed |= (uint64_t)p[i] << (8 * i);
+    game->game = 0;
+    for (int i = 0; i < 4; i++) game->game |= (uint32_t)p[8 + i] << (8 * i);
+    game->strategy[0] = p[12] & 15;
+    game->strategy[1] = p[12] >> 4;
+    game->discs[0] = p[13];
+    game->discs[1] = p[14];
+    game->plies = p[15];
+    if (game->plies > RECORD_MAX_PLIES || !fill(r, RECORD_HEADER_SIZE + (size_t)game->plies)) return 0;
+    memcpy(game->moves, r->buffer + r->pos + RECORD_HEADER_SIZE, (size_t)game->plies);
+    r->pos += RECORD_HEADER_SIZE + (size_t)game->plies;
+    return 1;
+}
+
+void record_reader_close(RecordReader* r) {
+    fclose(r->fp);
+    free(r);
+}
+
+void record_init(GameRecord* game, uint64_t seed, uint32_t game_index, int black_strategy, int white_strategy) {
+    game->seed = seed;
+    game->game = game_index;
+    game->strategy[0] = (uint8_t)black_strategy;
+    game->strategy[1] = (uint8_t)white_strategy;
+    game->discs[0] = game->discs[1] = 0;
+    game->plies = 0;
+}
+
+void record_add(GameRecord* game, int sq) {
+    if (game->plies < RECORD_MAX_PLIES) game->moves[game->plies++] = (uint8_t)(sq < 0 ? RECORD_PASS : sq);
+}
+
+int record_replay(const GameRecord* game, int plies, int board[8][8], int* color) {
+    if (plies < 0 || plies > game->plies) plies = game->plies;
+    init_board(board);
+    *color = BLACK;
+    for (int i = 0; i < plies; i++) {
+        int sq = game->moves[i];
+        if (sq == RECORD_PASS) {
+            if (has_valid_move(board, *color)) return 0;
+        }
+        else {
+            if (sq > 63 || !is_valid_move(board, sq / 8, sq % 8, *color)) return 0;
+            apply_move(board, sq / 8, sq % 8, *color);
+        }
+        *color = -*color;
+    }
+    return 1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// A record file is the magic "OTHREC01" followed by games back to back. A game is a
+// 16-byte header and one byte per ply: the square played (row * 8 + col) or RECORD_PASS.
+// The final double pass is implied by the end of the game and not stored.
+//
+// header (little-endian): seed (8) | game (4) | strategies (1, black in the low nibble) |
+//                         black discs (1) | white discs (1) | plies (1)
+#define RECORD_PASS 64
+#define RECORD_MAX_PLIES 128
+#define RECORD_HEADER_SIZE 16
+#define RECORD_BUFFER_SIZE (1 << 20)
+
+typedef struct {
+    uint64_t seed;          // run seed the game was played from
+    uint32_t game;          // index of the game within the run
+    uint8_t strategy[2];    // [0] black, [1] white (Strategy values)
+    uint8_t discs[2];       // final count_stones for black and white
+    int plies;
+    uint8_t moves[RECORD_MAX_PLIES];
+} GameRecord;
+
+// Streams records through a large buffer so each game is a memcpy and the disk sees
+// a few big writes. Not thread-safe; callers share one writer behind their own lock.
+typedef struct {
+    FILE* fp;
+    size_t used;
+    int failed;
+    unsigned char buffer[RECORD_BUFFER_SIZE];
+} RecordWriter;
+
+typedef struct {
+    FILE* fp;
+    size_t pos, len;
+    unsigned char buffer[RECORD_BUFFER_SIZE];
+} RecordReader;
+
+// Writers and readers are big; allocate them with these rather than on the stack.
+RecordWriter* record_writer_open(const char* path);
+void record_write(RecordWriter* w, const GameRecord* game);
+// Flushes and closes; 0 if any write failed.
+int record_writer_close(RecordWriter* w);
+
+RecordReader* record_reader_open(const char* path);
+// 1 and the next game, or 0 at the end of the file or on a truncated game.
+int record_read(RecordReader* r, GameRecord* game);
+void record_reader_close(RecordReader* r);
+
+void record_init(GameRecord* game, uint64_t seed, uint32_t game_index, int black_strategy, int white_strategy);
+void record_add(GameRecord* game, int sq);     // sq, or -1 for a pass
+
+// Replays the first plies plies (all of them if plies < 0) from the start position through
+// apply_move and leaves the position in board and the side to move in color.
+// Returns 0 if the record holds an illegal move.
+int record_replay(const GameRecord* game, int plies, int board[8][8], int* color);
+
+#endif
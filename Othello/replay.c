@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <string.h>
+#include "board.h"
+#include "computer.h"
+#include "platform.h"
+#include "record.h"
+
+// Prints a game as one line: header, then squares as column letter and row number
+// (a1 is row 0, col 0) with "--" for a pass.
+static void print_game(const GameRecord* game) {
+    printf("%llu/%u %s-%s %d-%d:", (unsigned long long)game->seed, game->game,
+        strategy_name((Strategy)game->strategy[0]), strategy_name((Strategy)game->strategy[1]),
+        game->discs[0], game->discs[1]);
+    for (int i = 0; i < game->plies; i++) {
+        int sq = game->moves[i];
+        if (sq == RECORD_PASS) printf(" --");
+        else printf(" %c%d", 'a' + sq % 8, sq / 8 + 1);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    int verbose = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) verbose = 1;
+        else if (!path) path = argv[i];
+        else path = NULL, i = argc;
+    }
+    if (!path) {
+        fprintf(stderr, "usage: othello_replay [-v] <record file>\n");
+        return 1;
+    }
+
+    RecordReader* reader = record_reader_open(path);
+    if (!reader) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+
+    GameRecord game;
+    long long games = 0, plies = 0, bad = 0;
+    long long black_wins = 0, white_wins = 0, draws = 0;
+    int64_t start = now_ms();
+
+    while (record_read(reader, &game)) {
+        int board[8][8];
+        int color;
+
+        if (verbose) print_game(&game);
+        if (!record_replay(&game, -1, board, &color) || !is_game_over(board)
+            || count_stones(board, BLACK) != game.discs[0] || count_stones(board, WHITE) != game.discs[1]) {
+            printf("game %lld (%llu/%u) does not replay to its result\n", games,
+                (unsigned long long)game.seed, game.game);
+            bad++;
+        }
+        games++;
+        plies += game.plies;
+        if (game.discs[0] > game.discs[1]) black_wins++;
+        else if (game.discs[0] < game.discs[1]) white_wins++;
+        else draws++;
+    }
+    record_reader_close(reader);
+
+    int64_t elapsed = now_ms() - start;
+    printf("%lld games, %lld plies, black %lld  white %lld  draw %lld\n", games, plies, black_wins, white_wins, draws);
+    printf("%lld games did not replay; %.0f games/s\n", bad, elapsed > 0 ? games * 1000.0 / elapsed : 0.0);
+    return bad != 0;
+}
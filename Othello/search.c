@@ -0,0 +1,512 @@
+#include <string.h>
+#include "search.h"
+#include "endgame.h"
+#include "eval.h"
+#include "nn.h"
+#include "platform.h"
+#include "solved.h"
+#include "tt.h"
+
+#define MAX_PLY 128
+
+// Move ordering: hash move, killers, then history plus a static score. From
+// ORDER_MOBILITY_DEPTH the static score is the opponent's mobility after the move,
+// from ORDER_SHALLOW_DEPTH a shallow search of each move.
+#define ORDER_TT (1 << 30)
+#define ORDER_KILLER (1 << 29)
+#define ORDER_MOBILITY_DEPTH 3
+#define ORDER_SHALLOW_DEPTH 9
+#define ORDER_SHALLOW_PLY 2
+// History scores are all halved once one passes this, so that together with a shallow
+// search's score * 16 they stay far below the killers' keys.
+#define HISTORY_MAX (1 << 20)
+
+// Half-width of a root move's first window around its previous score, in evaluation
+// units (about 16 per disc), doubled on each failure and dropped once past ASPIRATION_MAX.
+#define ASPIRATION_WINDOW 4
+#define ASPIRATION_MAX 128
+
+// XORed into the table keys of searches on the network evaluation, so that two evaluators
+// playing each other in one process never take each other's scores.
+#define NETWORK_KEY 0x6a09e667f3bcc908ULL
+
+typedef struct {
+    int sq;
+    int key;
+} OrderedMove;
+
+// A root move with its score from the last completed iteration: exact, or an upper bound
+// that was enough to keep it out of the best lines.
+typedef struct {
+    int sq;
+    int score;
+    int exact;
+} RootMove;
+
+// One Lazy SMP worker. All workers search the same root and talk only through the shared TT.
+typedef struct {
+    uint64_t nodes;
+    int64_t start;
+    int64_t deadline;
+    int soft_ms;            // the main worker starts no new iteration past this, 0 = no limit
+    int max_depth;          // 0 = no limit
+    uint64_t max_nodes;     // this worker's share of the node limit, 0 = no limit
+    const volatile int* halt;   // the caller's stop flag, may be NULL
+    volatile int* stop;
+    int id;
+    Position root;
+    int network;            // score leaves with nn_evaluate instead of the patterns
+    uint64_t table_key;     // XORed into table keys, see NETWORK_KEY
+    EvalState eval;         // pattern codes of the position being searched
+    SearchStats stats;
+    int ordering;
+    int lines;              // root moves to score exactly, 1 = only the best
+    int root_count;
+    RootMove roots[BB_MAX_MOVES];   // best first after each iteration
+    int killers[MAX_PLY][2];
+    int history[64];
+    SearchResult result;
+    Thread thread;
+} Search;
+
+static int final_score(uint64_t own, uint64_t opp) {
+    return diff_to_score(bb_count(own) - bb_count(opp));
+}
+
+static inline void make(Search* s, Position* pos, int sq, Undo* undo) {
+    int color = pos->color;
+    bb_make_move(pos, sq, undo);
+    eval_make_move(&s->eval, sq, undo->flipped, color);
+}
+
+static inline void unmake(Search* s, Position* pos, const Undo* undo) {
+    bb_undo_move(pos, undo);
+    eval_undo_move(&s->eval, undo->sq, undo->flipped, pos->color);
+}
+
+static inline int leaf_score(const Search* s, const Position* pos) {
+    return s->network ? nn_evaluate(pos->own, pos->opp) : eval_state_score(&s->eval, pos);
+}
+
+static int negamax(Search* s, Position* pos, int depth, int ply, int alpha, int beta, int passed);
+
+static void update_killers(Search* s, int ply, int sq, int depth) {
+    if (s->killers[ply][0] != sq) {
+        s->killers[ply][1] = s->killers[ply][0];
+        s->killers[ply][0] = sq;
+    }
+    s->history[sq] += depth * depth;
+    if (s->history[sq] > HISTORY_MAX)
+        for (int i = 0; i < 64; i++) s->history[i] /= 2;
+}
+
+static int order_moves(Search* s, Position* pos, uint64_t moves, int tt_move, int depth, int ply, OrderedMove* list) {
+    int n = 0;
+
+    for (; moves; moves &= moves - 1) {
+        int sq = bb_first(moves);
+        int key = 0;
+
+        if (!s->ordering) key = 0;
+        else if (sq == tt_move) key = ORDER_TT;
+        else if (sq == s->killers[ply][0]) key = ORDER_KILLER;
+        else if (sq == s->killers[ply][1]) key = ORDER_KILLER - 1;
+        else if (depth >= ORDER_SHALLOW_DEPTH) {
+            Undo undo;
+            make(s, pos, sq, &undo);
+            key = -negamax(s, pos, ORDER_SHALLOW_PLY, ply + 1, -SCORE_INF, SCORE_INF, 0) * 16 + s->history[sq];
+            unmake(s, pos, &undo);
+        }
+        else if (depth >= ORDER_MOBILITY_DEPTH) {
+            uint64_t flipped = bb_flips(pos->own, pos->opp, sq);
+            uint64_t replies = bb_moves(pos->opp ^ flipped, pos->own | flipped | SQ_BIT(sq));
+            key = s->history[sq] - 256 * bb_count(replies) + 4 * weights[sq / 8][sq % 8];
+        }
+        else {
+            key = s->history[sq] + 4 * weights[sq / 8][sq % 8];
+        }
+        list[n].sq = sq;
+        list[n].key = key;
+        n++;
+    }
+    return n;
+}
+
+// Moves the best remaining entry to list[i]; sorting lazily saves work after a cutoff.
+static inline int next_move(OrderedMove* list, int n, int i) {
+    int best = i;
+    for (int j = i + 1; j < n; j++)
+        if (list[j].key > list[best].key) best = j;
+    OrderedMove t = list[i];
+    list[i] = list[best];
+    list[best] = t;
+    return list[i].sq;
+}
+
+static int negamax(Search* s, Position* pos, int depth, int ply, int alpha, int beta, int passed) {
+    s->nodes++;
+    if ((s->nodes & 1023) == 0
+        && (now_ms() >= s->deadline || (s->max_nodes && s->nodes >= s->max_nodes) || (s->halt && *s->halt)))
+        *s->stop = 1;
+    if (*s->stop) return 0;
+
+    if (depth == 0) {
+        if (!~(pos->own | pos->opp)) return final_score(pos->own, pos->opp);
+        STAT_START(t);
+        int score = leaf_score(s, pos);
+        STAT_ELAPSED(&s->stats, eval_ticks, t);
+        return score;
+    }
+
+    TTEntry entry;
+    int tt_move = -1;
+    STAT_ADD(&s->stats, tt_probes, 1);
+    if (tt_probe(pos->hash ^ s->table_key, &entry)) {
+        STAT_ADD(&s->stats, tt_hits, 1);
+        tt_move = entry.move;
+        if (entry.depth >= depth) {
+            if (entry.bound == TT_EXACT) return entry.score;
+            if (entry.bound == TT_LOWER && entry.score >= beta) return entry.score;
+            if (entry.bound == TT_UPPER && entry.score <= alpha) return entry.score;
+        }
+    }
+
+    STAT_START(t);
+    uint64_t moves = bb_moves(pos->own, pos->opp);
+    STAT_ELAPSED(&s->stats, movegen_ticks, t);
+    if (!moves) {
+        if (passed) return final_score(pos->own, pos->opp);
+        bb_pass(pos);
+        int score = -negamax(s, pos, depth, ply + 1, -beta, -alpha, 1);
+        bb_pass(pos);
+        return score;
+    }
+    if (ply >= MAX_PLY - 1) return leaf_score(s, pos);
+    STAT_ADD(&s->stats, expanded, 1);
+    STAT_ADD(&s->stats, children, bb_count(moves));
+
+    OrderedMove list[BB_MAX_MOVES];
+    int n = order_moves(s, pos, moves, tt_move, depth, ply, list);
+    int alpha_orig = alpha;
+    int best = -SCORE_INF;
+    int best_move = -1;
+
+    for (int i = 0; i < n; i++) {
+        int sq = next_move(list, n, i);
+        Undo undo;
+
+        make(s, pos, sq, &undo);
+        int score = -negamax(s, pos, depth - 1, ply + 1, -beta, -alpha, 0);
+        unmake(s, pos, &undo);
+        if (*s->stop) return 0;
+        if (score > best) {
+            best = score;
+            best_move = sq;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) {
+                    STAT_ADD(&s->stats, cutoffs, 1);
+                    STAT_ADD(&s->stats, first_cutoffs, i == 0);
+                    update_killers(s, ply, sq, depth);
+                    break;
+                }
+            }
+        }
+    }
+
+    tt_store(pos->hash ^ s->table_key, depth, best >= beta ? TT_LOWER : best > alpha_orig ? TT_EXACT : TT_UPPER, best, best_move);
+    return best;
+}
+
+static int search_root_move(Search* s, int sq, int depth, int alpha, int beta) {
+    Undo undo;
+    make(s, &s->root, sq, &undo);
+    int score = -negamax(s, &s->root, depth - 1, 1, -beta, -alpha, 0);
+    unmake(s, &s->root, &undo);
+    return score;
+}
+
+// Searches every root move to depth into next. The first k moves, the best ones of the
+// last iteration, get exact scores, starting from an aspiration window around the old
+// score; every later move is searched exactly only if it beats the k-th best so far.
+// Returns 0 if stopped.
+static int search_root(Search* s, int depth, int k, RootMove* next) {
+    int top[SEARCH_MAX_LINES];      // exact scores so far, best first
+    int found = 0;
+
+    for (int i = 0; i < s->root_count; i++) {
+        const RootMove* r = &s->roots[i];
+        int threshold = found < k ? -SCORE_INF : top[k - 1];
+        int alpha = threshold;
+        int beta = SCORE_INF;
+        int delta = ASPIRATION_WINDOW;
+        int score;
+
+        if (i < k && r->exact) {
+            alpha = r->score - delta;
+            beta = r->score + delta;
+        }
+        for (;;) {
+            score = search_root_move(s, r->sq, depth, alpha, beta);
+            if (*s->stop) return 0;
+            if (score <= alpha && alpha > threshold) {
+                delta *= 2;
+                alpha = delta > ASPIRATION_MAX || score - delta < threshold ? threshold : score - delta;
+            }
+            else if (score >= beta) {
+                delta *= 2;
+                beta = delta > ASPIRATION_MAX || score + delta > SCORE_INF ? SCORE_INF : score + delta;
+            }
+            else break;
+        }
+
+        next[i].sq = r->sq;
+        next[i].score = score;
+        next[i].exact = score > threshold;
+        if (score > threshold) {
+            int j = found < k ? found++ : k - 1;
+            for (; j > 0 && top[j - 1] < score; j--) top[j] = top[j - 1];
+            top[j] = score;
+        }
+    }
+    return 1;
+}
+
+// Moves the best k entries to the front, best first, keeping the others in order.
+static void sort_roots(RootMove* roots, int n, int k) {
+    for (int i = 0; i < k && i < n; i++) {
+        int best = i;
+        for (int j = i + 1; j < n; j++)
+            if (roots[j].score > roots[best].score || (roots[j].score == roots[best].score && roots[j].exact > roots[best].exact))
+                best = j;
+        RootMove t = roots[best];
+        for (int j = best; j > i; j--) roots[j] = roots[j - 1];
+        roots[i] = t;
+    }
+}
+
+static void iterate(Search* s) {
+    Position* root = &s->root;
+    uint64_t moves = bb_moves(root->own, root->opp);
+    int empties = 64 - bb_count(root->own | root->opp);
+    RootMove* list = s->roots;
+    RootMove next[BB_MAX_MOVES];
+    int n = 0;
+
+    // Helpers start from a different root move and half of them one ply deeper,
+    // so the workers spread over the tree instead of repeating each other.
+    for (; moves; moves &= moves - 1) {
+        list[n].sq = bb_first(moves);
+        list[n].score = 0;
+        list[n++].exact = 0;
+    }
+    for (int i = 0; i < s->id % n; i++) {
+        RootMove first = list[0];
+        for (int j = 1; j < n; j++) list[j - 1] = list[j];
+        list[n - 1] = first;
+    }
+    s->root_count = n;
+    s->result.move = list[0].sq;
+    eval_state_init(&s->eval, root);
+    for (int i = 0; i < MAX_PLY; i++) s->killers[i][0] = s->killers[i][1] = -1;
+    for (int i = 0; i < 64; i++) s->history[i] = 0;
+
+    int k = s->lines < n ? s->lines : n;
+    int max_depth = s->max_depth > 0 && s->max_depth < empties ? s->max_depth : empties;
+    for (int depth = 1 + (s->id & 1); depth <= max_depth; depth++) {
+        if (!search_root(s, depth, k, next)) break;
+
+        // Search this iteration's best moves first next time.
+        sort_roots(next, n, k);
+        memcpy(list, next, (size_t)n * sizeof(list[0]));
+        s->result.move = list[0].sq;
+        s->result.score = list[0].score;
+        s->result.depth = depth;
+        tt_store(root->hash ^ s->table_key, depth, TT_EXACT, list[0].score, list[0].sq);
+
+        // The next iteration would take several times longer than this one.
+        if (s->id == 0 && s->soft_ms > 0 && now_ms() - s->start > s->soft_ms / 2) break;
+    }
+
+    if (s->id == 0) *s->stop = 1;
+}
+
+static void helper_main(void* arg) {
+    iterate(arg);
+}
+
+void search_params_init(SearchParams* params) {
+    params->time_ms = 1000;
+    params->depth = 0;
+    params->endgame_empties = ENDGAME_DEFAULT_EMPTIES;
+    params->threads = 1;
+    params->nodes = 0;
+    params->stop = NULL;
+    params->ordering = 1;
+    params->evaluator = EVAL_PATTERNS;
+}
+
+// Follows the table's moves from pos, under keys XORed with key, for at most max plies into line.
+static int table_line(Position pos, uint64_t key, int max, int* line) {
+    int n = 0;
+
+    while (n < max) {
+        uint64_t moves = bb_moves(pos.own, pos.opp);
+        TTEntry entry;
+        Undo undo;
+
+        if (!moves) {
+            if (!bb_moves(pos.opp, pos.own)) break;
+            bb_pass(&pos);
+            line[n++] = -1;
+            continue;
+        }
+        if (!tt_probe(pos.hash ^ key, &entry) || entry.move < 0 || !(moves & SQ_BIT(entry.move))) break;
+        line[n++] = entry.move;
+        bb_make_move(&pos, entry.move, &undo);
+    }
+    // A pass says nothing without the move after it.
+    while (n > 0 && line[n - 1] == -1) n--;
+    return n;
+}
+
+// search_best_move with k lines; lines is NULL when only the best move is wanted.
+static int run(const Position* pos, const SearchParams* params, int k, SearchLine* lines, SearchResult* result) {
+    Search workers[SEARCH_MAX_THREADS];
+    volatile int stop = 0;
+    // Shared tables first, so that their setup is not charged to the move's budget.
+    tt_ensure();
+    eval_init();
+    if (params->evaluator == EVAL_NETWORK) nn_init();
+    int64_t start = now_ms();
+    STAT_START(start_ticks);
+    uint64_t root_moves = bb_moves(pos->own, pos->opp);
+    int empties = 64 - bb_count(pos->own | pos->opp);
+    int time_ms = params->time_ms;
+    int threads = params->threads;
+    // A forced move is played at once under a clock; without one, or for analysis, it is
+    // still searched for its score.
+    int search = root_moves && (bb_count(root_moves) > 1 || time_ms <= 0 || lines);
+    // Near the end a short midgame search only provides a fallback move and ordering for the solver.
+    int solve = search && empties <= params->endgame_empties;
+    int mid_ms = solve ? time_ms / 4 : time_ms;
+    uint64_t mid_nodes = solve ? params->nodes / 4 : params->nodes;
+    int64_t no_deadline = INT64_MAX / 2;
+    int line_moves[SEARCH_MAX_LINES], line_scores[SEARCH_MAX_LINES];
+    int count = 0;
+
+    tt_new_search();
+    if (threads < 1) threads = 1;
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+    if (k < 1) k = 1;
+    if (k > SEARCH_MAX_LINES) k = SEARCH_MAX_LINES;
+
+    result->move = root_moves ? bb_first(root_moves) : -1;
+    result->score = 0;
+    result->depth = 0;
+    result->nodes = 0;
+    memset(&result->stats, 0, sizeof(result->stats));
+
+    // Solved in an earlier game or run: no search at all. The database has one line only.
+    int diff, move;
+    if (solve && k == 1 && solved_probe(pos, &diff, &move) && move >= 0 && (root_moves & SQ_BIT(move))) {
+        result->move = move;
+        result->score = diff_to_score(diff);
+        result->depth = empties;
+        line_moves[0] = move;
+        line_scores[0] = result->score;
+        count = 1;
+        search = solve = 0;
+    }
+
+    if (search) {
+        for (int i = 0; i < threads; i++) {
+            Search* s = &workers[i];
+            s->nodes = 0;
+            s->start = start;
+            s->deadline = time_ms > 0 ? start + mid_ms : no_deadline;
+            s->soft_ms = time_ms > 0 ? mid_ms : 0;
+            s->max_depth = params->depth;
+            s->max_nodes = params->nodes ? mid_nodes / (uint64_t)threads + 1 : 0;
+            s->halt = params->stop;
+            s->ordering = params->ordering;
+            s->network = params->evaluator == EVAL_NETWORK;
+            s->table_key = s->network ? NETWORK_KEY : 0;
+            s->lines = k;
+            s->stop = &stop;
+            s->id = i;
+            s->root = *pos;
+            s->result = *result;
+            memset(&s->stats, 0, sizeof(s->stats));
+        }
+        for (int i = 1; i < threads; i++)
+            if (!thread_start(&workers[i].thread, helper_main, &workers[i])) threads = i;
+
+        iterate(&workers[0]);
+        for (int i = 1; i < threads; i++) thread_join(&workers[i].thread);
+
+        // Take the deepest completed iteration; the main worker wins ties.
+        uint64_t nodes = 0;
+        const Search* best = &workers[0];
+        for (int i = 0; i < threads; i++) {
+            if (workers[i].result.depth > best->result.depth) best = &workers[i];
+            nodes += workers[i].nodes;
+        }
+        *result = best->result;
+        result->nodes = nodes;
+        count = k < best->root_count ? k : best->root_count;
+        for (int i = 0; i < count; i++) {
+            line_moves[i] = best->roots[i].sq;
+            line_scores[i] = best->roots[i].score;
+        }
+        for (int i = 0; i < threads; i++) stats_add(&result->stats, &workers[i].stats);
+    }
+
+    if (solve) {
+        EndgameResult end;
+        int solved_moves[SEARCH_MAX_LINES], solved_diffs[SEARCH_MAX_LINES], solved_count;
+        uint64_t left = params->nodes > result->nodes ? params->nodes - result->nodes : 1;
+        if (endgame_solve_lines(pos, k, time_ms > 0 ? start + time_ms : no_deadline, params->nodes ? left : 0, params->stop,
+                solved_moves, solved_diffs, &solved_count, &end)) {
+            result->move = end.move;
+            result->score = diff_to_score(end.score);
+            result->depth = empties;
+            count = solved_count < k ? solved_count : k;
+            for (int i = 0; i < count; i++) {
+                line_moves[i] = solved_moves[i];
+                line_scores[i] = diff_to_score(solved_diffs[i]);
+            }
+        }
+        result->nodes += end.nodes;
+        stats_add(&result->stats, &end.stats);
+    }
+
+    result->time_ms = now_ms() - start;
+    result->stats.nodes = result->nodes;
+    result->stats.depth = result->depth;
+    result->stats.time_ms = result->time_ms;
+    STAT_ELAPSED(&result->stats, ticks, start_ticks);
+
+    if (!lines) return count;
+    for (int i = 0; i < count; i++) {
+        SearchLine* line = &lines[i];
+        Position next = *pos;
+        Undo undo;
+        int plies = result->depth < SEARCH_MAX_PV ? result->depth : SEARCH_MAX_PV;
+
+        line->move = line_moves[i];
+        line->score = line_scores[i];
+        line->pv[0] = line->move;
+        bb_make_move(&next, line->move, &undo);
+        line->pv_length = 1 + table_line(next, params->evaluator == EVAL_NETWORK ? NETWORK_KEY : 0, plies - 1, line->pv + 1);
+    }
+    return count;
+}
+
+void search_best_move(const Position* pos, const SearchParams* params, SearchResult* result) {
+    run(pos, params, 1, NULL, result);
+}
+
+int search_analyze(const Position* pos, const SearchParams* params, int k, SearchLine* lines, SearchResult* result) {
+    return run(pos, params, k, lines, result);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "bitboard.h"
+#include "eval.h"
+#include "stats.h"
+
+#define SCORE_INF 30000
+#define SCORE_WIN 10000
+#define SEARCH_MAX_THREADS 64
+#define SEARCH_MAX_LINES BB_MAX_MOVES
+#define SEARCH_MAX_PV 32
+
+// Final disc difference in search score units: wins and losses dominate any evaluation.
+static inline int diff_to_score(int diff) {
+    return diff > 0 ? SCORE_WIN + diff : diff < 0 ? -SCORE_WIN + diff : 0;
+}
+
+static inline int score_to_diff(int score) {
+    return score > 0 ? score - SCORE_WIN : score < 0 ? score + SCORE_WIN : 0;
+}
+
+typedef struct {
+    int move;       // best square, -1 when there is no legal move
+    int score;
+    int depth;      // last fully searched depth
+    uint64_t nodes;
+    int64_t time_ms;
+    SearchStats stats;      // counters for the whole search, the endgame solve included
+} SearchResult;
+
+typedef struct {
+    int time_ms;            // per-move budget, 0 = no limit
+    int depth;              // maximum midgame depth, 0 = no limit
+    int endgame_empties;    // solve exactly from this many empties if time allows
+    int threads;            // > 1 runs Lazy SMP helpers sharing the transposition table
+    uint64_t nodes;         // stop after about this many nodes, 0 = no limit
+    const volatile int* stop;   // set non-zero from another thread to stop early; may be NULL
+    int ordering;           // move ordering; switched off only to measure its effect
+    Evaluator evaluator;    // leaf scores, EVAL_PATTERNS by default
+} SearchParams;
+
+// One analysed root move. The principal variation comes from the transposition table
+// after the search, so it can stop short of the depth searched.
+typedef struct {
+    int move;
+    int score;
+    int pv_length;
+    int pv[SEARCH_MAX_PV];      // pv[0] is move; -1 is a pass
+} SearchLine;
+
+void search_params_init(SearchParams* params);
+
+// Iterative-deepening alpha-beta on pos. Whenever it stops, result holds a legal move
+// (the best of the last completed iteration) if there is one.
+void search_best_move(const Position* pos, const SearchParams* params, SearchResult* result);
+
+// One search that scores the best k root moves exactly, best first, where k separate
+// searches with moves left out would repeat most of the work. Each of them is searched
+// in an aspiration window around its score from the previous iteration; every other move
+// only has to fail low against the k-th best. Returns how many lines were filled (fewer
+// than k if there are fewer legal moves, 0 if the side to move must pass); result is as
+// for search_best_move, with the best line's move and score.
+int search_analyze(const Position* pos, const SearchParams* params, int k, SearchLine* lines, SearchResult* result);
+
+#endif
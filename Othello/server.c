@@ -0,0 +1,580 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "bitboard.h"
+#include "book.h"
+#include "computer.h"
+#include "eval.h"
+#include "platform.h"
+#include "solved.h"
+#include "tt.h"
+
+// Sessions never ponder: with thousands of games waiting on their humans, pondering would
+// need a thread per game instead of a pool, so workers only search once a move arrives.
+#define MAX_WORKERS 256
+#define LINE_SIZE 256
+#define NO_SESSION UINT32_MAX
+
+// An ended session keeps its id, CLOSING while its move is still being searched and
+// DRAINING while only analyses of it are, so no late reply can reach a new game.
+enum { FREE, IDLE, THINKING, CLOSING, OVER, DRAINING };
+
+// Everything a game keeps between moves. Engine state is shared (tables, book) or per
+// worker (search scratch), so an idle session costs only these 32 bytes.
+typedef struct {
+    uint64_t black, white;
+    uint64_t seed;          // for the random strategy, mixed with the disc count per move
+    uint8_t state;
+    uint8_t strategy;
+    int8_t human;           // BLACK or WHITE
+    int8_t to_move;
+    uint32_t link;          // next session in the free list or the work queue
+} Session;
+
+// A pending analyze command. The position is copied, so sessions stay 32 bytes and the
+// game may go on meanwhile.
+typedef struct Analysis {
+    struct Analysis* next;
+    Position pos;
+    uint32_t id;
+    int lines;
+} Analysis;
+
+typedef struct {
+    Mutex lock;             // sessions, free list and both queues
+    Cond work;
+    Session* sessions;
+    uint32_t capacity, used, live;
+    uint32_t free_head;
+    uint32_t queue_head, queue_tail;
+    uint32_t queued;
+    Analysis* analysis_head;    // served after the queued moves
+    Analysis* analysis_tail;
+    Analysis* analysing;        // taken by a worker and not yet answered
+    int shutdown;
+    uint64_t seed;
+
+    Mutex out;              // one reply line at a time, and one statistics line
+    FILE* stats;            // per-move JSON lines, NULL unless -x
+    SearchLimits limits;
+} Server;
+
+static void reply(Server* server, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    mutex_lock(&server->out);
+    vprintf(format, args);
+    putchar('\n');
+    fflush(stdout);
+    mutex_unlock(&server->out);
+    va_end(args);
+}
+
+static void log_stats(Server* server, uint32_t id, const Position* pos, Strategy strategy, const SearchStats* stats) {
+    char fields[512];
+
+    stats_format_json(stats, fields, sizeof(fields));
+    mutex_lock(&server->out);
+    fprintf(server->stats, "{\"game\":%u,\"empties\":%d,\"strategy\":\"%s\",%s}\n", id,
+        64 - bb_count(pos->own | pos->opp), strategy_name(strategy), fields);
+    fflush(server->stats);
+    mutex_unlock(&server->out);
+}
+
+static void square_name(int sq, char out[3]) {
+    out[0] = (char)('a' + sq % 8);
+    out[1] = (char)('1' + sq / 8);
+    out[2] = '\0';
+}
+
+static int parse_square(const char* text) {
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8' || text[2]) return -1;
+    return SQ(text[1] - '1', text[0] - 'a');
+}
+
+static void to_position(const Session* s, Position* pos) {
+    bb_set_position(pos, s->to_move == BLACK ? s->black : s->white, s->to_move == BLACK ? s->white : s->black, s->to_move);
+}
+
+static void from_position(Session* s, const Position* pos) {
+    s->black = pos->color == BLACK ? pos->own : pos->opp;
+    s->white = pos->color == BLACK ? pos->opp : pos->own;
+    s->to_move = (int8_t)pos->color;
+}
+
+// Called with the lock held. Returns NO_SESSION if out of memory.
+static uint32_t session_alloc(Server* server) {
+    uint32_t id = server->free_head;
+
+    if (id != NO_SESSION) {
+        server->free_head = server->sessions[id].link;
+    }
+    else {
+        if (server->used == server->capacity) {
+            uint32_t capacity = server->capacity ? server->capacity * 2 : 1024;
+            Session* sessions = realloc(server->sessions, capacity * sizeof(Session));
+            if (!sessions) return NO_SESSION;
+            server->sessions = sessions;
+            server->capacity = capacity;
+        }
+        id = server->used++;
+    }
+    server->live++;
+    return id;
+}
+
+static void session_free(Server* server, uint32_t id) {
+    server->sessions[id].state = FREE;
+    server->sessions[id].link = server->free_head;
+    server->free_head = id;
+    server->live--;
+}
+
+// Called with the lock held. Whether a worker is analysing session id right now.
+static int analysing(const Server* server, uint32_t id) {
+    for (const Analysis* a = server->analysing; a; a = a->next)
+        if (a->id == id) return 1;
+    return 0;
+}
+
+// Called with the lock held; drops the analyses of session id no worker has taken yet.
+static void cancel_analyses(Server* server, uint32_t id) {
+    Analysis** link = &server->analysis_head;
+
+    server->analysis_tail = NULL;
+    while (*link) {
+        Analysis* a = *link;
+        if (a->id == id) {
+            *link = a->next;
+            free(a);
+        }
+        else {
+            server->analysis_tail = a;
+            link = &a->next;
+        }
+    }
+}
+
+// Called with the lock held; the session must not be queued already.
+static void enqueue(Server* server, uint32_t id) {
+    server->sessions[id].state = THINKING;
+    server->sessions[id].link = NO_SESSION;
+    if (server->queue_tail == NO_SESSION) server->queue_head = id;
+    else server->sessions[server->queue_tail].link = id;
+    server->queue_tail = id;
+    server->queued++;
+    cond_signal(&server->work);
+}
+
+// Plays the computer's moves, and the human's forced passes, until the human has a
+// move or the game is over. Replies go out after the session is updated, so a client
+// may answer as soon as it reads them.
+static void think(Server* server, ComputerContext* ctx, uint32_t id, Session s) {
+    char lines[4096];       // a line per ply, at most 60 moves and fewer passes
+    size_t used = 0;
+    Position pos;
+    SearchLimits limits = server->limits;
+    int over = 0;
+
+    to_position(&s, &pos);
+    limits.strategy = (Strategy)s.strategy;
+    for (;;) {
+        uint64_t moves = bb_moves(pos.own, pos.opp);
+        char name[3];
+
+        if (!moves && !bb_moves(pos.opp, pos.own)) {
+            over = 1;
+            break;
+        }
+        if (pos.color == s.human) {
+            if (moves) break;
+            used += (size_t)snprintf(lines + used, sizeof(lines) - used, "pass %u\n", id);
+            bb_pass(&pos);
+            continue;
+        }
+        if (!moves) {
+            used += (size_t)snprintf(lines + used, sizeof(lines) - used, "move %u pass\n", id);
+            bb_pass(&pos);
+            continue;
+        }
+
+        Undo undo;
+        rng_seed(&ctx->rng, s.seed + (uint64_t)bb_count(pos.own | pos.opp) * 0x9e3779b97f4a7c15ULL);
+        int sq = computer_move(ctx, &pos, &limits);
+        if (server->stats) log_stats(server, id, &pos, limits.strategy, &ctx->stats);
+        square_name(sq, name);
+        bb_make_move(&pos, sq, &undo);
+        used += (size_t)snprintf(lines + used, sizeof(lines) - used, "move %u %s\n", id, name);
+    }
+
+    mutex_lock(&server->lock);
+    Session* live = &server->sessions[id];
+    int closed = live->state == CLOSING;
+    if (closed) {
+        if (analysing(server, id)) live->state = DRAINING;
+        else session_free(server, id);
+    }
+    else {
+        from_position(live, &pos);
+        live->state = over ? OVER : IDLE;
+    }
+    mutex_unlock(&server->lock);
+
+    if (closed) return;
+    if (over) {
+        uint64_t black = pos.color == BLACK ? pos.own : pos.opp;
+        snprintf(lines + used, sizeof(lines) - used, "over %u %d %d\n", id, bb_count(black),
+            bb_count((pos.own | pos.opp) ^ black));
+    }
+    else {
+        snprintf(lines + used, sizeof(lines) - used, "turn %u\n", id);
+    }
+    mutex_lock(&server->out);
+    fputs(lines, stdout);
+    fflush(stdout);
+    mutex_unlock(&server->out);
+}
+
+// Answers an analyze command: analysis <id> <depth> <n> and then n lines
+// line <id> <square> <score> <pv...>, best first, written out together.
+static void analyse(Server* server, ComputerContext* ctx, const Analysis* a) {
+    SearchLine lines[SEARCH_MAX_LINES];
+    char text[SEARCH_MAX_LINES * (SEARCH_MAX_PV * 5 + 32) + 64];
+    SearchLimits limits = server->limits;
+    size_t used;
+
+    int n = computer_analyze(ctx, &a->pos, &limits, a->lines, lines);
+    if (server->stats) log_stats(server, a->id, &a->pos, SEARCH, &ctx->stats);
+    used = (size_t)snprintf(text, sizeof(text), "analysis %u %d %d\n", a->id, ctx->stats.depth, n);
+    for (int i = 0; i < n; i++) {
+        char name[3];
+        square_name(lines[i].move, name);
+        used += (size_t)snprintf(text + used, sizeof(text) - used, "line %u %s %d", a->id, name, lines[i].score);
+        for (int j = 1; j < lines[i].pv_length; j++) {
+            if (lines[i].pv[j] < 0) strcpy(name, "--");
+            else square_name(lines[i].pv[j], name);
+            used += (size_t)snprintf(text + used, sizeof(text) - used, " %s", name);
+        }
+        used += (size_t)snprintf(text + used, sizeof(text) - used, "\n");
+    }
+    mutex_lock(&server->out);
+    fputs(text, stdout);
+    fflush(stdout);
+    mutex_unlock(&server->out);
+}
+
+static void worker_main(void* arg) {
+    Server* server = arg;
+    ComputerContext ctx;
+
+    computer_init(&ctx, 0);
+    for (;;) {
+        mutex_lock(&server->lock);
+        while (server->queue_head == NO_SESSION && !server->analysis_head && !server->shutdown)
+            cond_wait(&server->work, &server->lock);
+        if (server->queue_head == NO_SESSION && !server->analysis_head) {
+            mutex_unlock(&server->lock);
+            break;
+        }
+        if (server->queue_head == NO_SESSION) {
+            Analysis* a = server->analysis_head;
+            server->analysis_head = a->next;
+            if (!server->analysis_head) server->analysis_tail = NULL;
+            a->next = server->analysing;
+            server->analysing = a;
+            mutex_unlock(&server->lock);
+            analyse(server, &ctx, a);
+
+            // The reply is out, so the last analysis of an ended session can let its id go.
+            mutex_lock(&server->lock);
+            Analysis** link = &server->analysing;
+            while (*link != a) link = &(*link)->next;
+            *link = a->next;
+            if (server->sessions[a->id].state == DRAINING && !analysing(server, a->id)) session_free(server, a->id);
+            mutex_unlock(&server->lock);
+            free(a);
+            continue;
+        }
+        uint32_t id = server->queue_head;
+        Session s = server->sessions[id];
+        server->queue_head = s.link;
+        if (server->queue_head == NO_SESSION) server->queue_tail = NO_SESSION;
+        server->queued--;
+        mutex_unlock(&server->lock);
+
+        think(server, &ctx, id, s);
+    }
+    computer_free(&ctx);
+}
+
+// Returns the session for a command argument, with the lock held, or NULL (lock released).
+static Session* lookup(Server* server, const char* arg, uint32_t* id) {
+    char* end;
+    unsigned long n = arg ? strtoul(arg, &end, 10) : 0;
+
+    if (!arg || *end) return NULL;
+    mutex_lock(&server->lock);
+    if (n >= server->used || server->sessions[n].state == FREE || server->sessions[n].state == CLOSING
+        || server->sessions[n].state == DRAINING) {
+        mutex_unlock(&server->lock);
+        return NULL;
+    }
+    *id = (uint32_t)n;
+    return &server->sessions[n];
+}
+
+static void command_new(Server* server, const char* strategy_arg, const char* color_arg) {
+    Strategy strategy;
+    int human = BLACK;
+    uint32_t id;
+
+    if (!strategy_arg || !parse_strategy(strategy_arg, &strategy)) {
+        reply(server, "error new unknown strategy");
+        return;
+    }
+    if (color_arg && strcmp(color_arg, "white") == 0) human = WHITE;
+    else if (color_arg && strcmp(color_arg, "black") != 0) {
+        reply(server, "error new colour must be black or white");
+        return;
+    }
+
+    mutex_lock(&server->lock);
+    id = session_alloc(server);
+    if (id == NO_SESSION) {
+        mutex_unlock(&server->lock);
+        reply(server, "error new out of memory");
+        return;
+    }
+    Session* s = &server->sessions[id];
+    s->black = SQ_BIT(SQ(3, 4)) | SQ_BIT(SQ(4, 3));
+    s->white = SQ_BIT(SQ(3, 3)) | SQ_BIT(SQ(4, 4));
+    s->seed = server->seed * 0xc2b2ae3d27d4eb4fULL + id + ((uint64_t)server->live << 32);
+    s->strategy = (uint8_t)strategy;
+    s->human = (int8_t)human;
+    s->to_move = BLACK;
+    s->state = IDLE;
+    // Said before the computer can reply, so "ok" always comes first.
+    reply(server, "ok %u", id);
+    if (human == WHITE) enqueue(server, id);
+    mutex_unlock(&server->lock);
+}
+
+static void command_move(Server* server, const char* id_arg, const char* square_arg) {
+    uint32_t id;
+    Session* s = lookup(server, id_arg, &id);
+    int sq = square_arg ? parse_square(square_arg) : -1;
+    const char* error = NULL;
+    Position pos;
+
+    if (!s) {
+        reply(server, "error %s no such game", id_arg ? id_arg : "-");
+        return;
+    }
+    to_position(s, &pos);
+    if (s->state == THINKING) error = "not your turn";
+    else if (s->state == OVER) error = "game over";
+    else if (sq < 0 || !(bb_moves(pos.own, pos.opp) & SQ_BIT(sq))) error = "illegal move";
+    else {
+        Undo undo;
+        bb_make_move(&pos, sq, &undo);
+        from_position(s, &pos);
+        enqueue(server, id);
+    }
+    mutex_unlock(&server->lock);
+    if (error) reply(server, "error %u %s", id, error);
+}
+
+static void command_show(Server* server, const char* id_arg) {
+    uint32_t id;
+    Session* s = lookup(server, id_arg, &id);
+    Position pos;
+    char text[67];
+
+    if (!s) {
+        reply(server, "error %s no such game", id_arg ? id_arg : "-");
+        return;
+    }
+    to_position(s, &pos);
+    mutex_unlock(&server->lock);
+    bb_format(&pos, text);
+    reply(server, "board %u %s", id, text);
+}
+
+static void command_end(Server* server, const char* id_arg) {
+    uint32_t id;
+    Session* s = lookup(server, id_arg, &id);
+
+    if (!s) {
+        reply(server, "error %s no such game", id_arg ? id_arg : "-");
+        return;
+    }
+    // The id is only reused once no worker can still answer for it: queued analyses are
+    // dropped, and a worker still thinking or analysing frees the session when it is done.
+    cancel_analyses(server, id);
+    if (s->state == THINKING) s->state = CLOSING;
+    else if (analysing(server, id)) s->state = DRAINING;
+    else session_free(server, id);
+    mutex_unlock(&server->lock);
+    reply(server, "ok %u", id);
+}
+
+static void command_analyze(Server* server, const char* id_arg, const char* lines_arg) {
+    uint32_t id;
+    Session* s = lookup(server, id_arg, &id);
+    int lines = lines_arg ? atoi(lines_arg) : 1;
+    const char* error = NULL;
+
+    if (!s) {
+        reply(server, "error %s no such game", id_arg ? id_arg : "-");
+        return;
+    }
+    Analysis* a = NULL;
+    if (s->state == THINKING) error = "not your turn";
+    else if (s->state == OVER) error = "game over";
+    else if (lines < 1 || lines > SEARCH_MAX_LINES) error = "lines must be 1 to 64";
+    else if (!(a = malloc(sizeof(*a)))) error = "out of memory";
+    else {
+        to_position(s, &a->pos);
+        a->id = id;
+        a->lines = lines;
+        a->next = NULL;
+        if (server->analysis_tail) server->analysis_tail->next = a;
+        else server->analysis_head = a;
+        server->analysis_tail = a;
+        cond_signal(&server->work);
+    }
+    mutex_unlock(&server->lock);
+    if (error) reply(server, "error %u %s", id, error);
+}
+
+static void command_stats(Server* server) {
+    mutex_lock(&server->lock);
+    uint32_t live = server->live, queued = server->queued, capacity = server->capacity;
+    mutex_unlock(&server->lock);
+    reply(server, "stats sessions %u queued %u session_bytes %zu table_bytes %zu solved %zu", live, queued,
+        sizeof(Session), (size_t)capacity * sizeof(Session), solved_size());
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: othello_server [options]\n"
+        "  -j N   worker threads (default 4)\n"
+        "  -m MS  per-move time for the search strategy (default 100)\n"
+        "  -h MB  transposition table size shared by all games (default 16)\n"
+        "  -b FILE opening book shared by all games (default othello.book if present)\n"
+        "  -d FILE solved-endgame database shared by all games, created if missing\n"
+        "  -x FILE write per-move search statistics as JSON lines\n"
+        "  -w FILE evaluation weights shared by all games (default othello.weights if present)\n"
+        "  -s N   seed for the random strategy (default 1)\n"
+        "commands on stdin, one per line:\n"
+        "  new <strategy> [black|white]   start a game, the human plays the given colour\n"
+        "  move <id> <square>             human move, e.g. f5\n"
+        "  analyze <id> [k]               the best k moves for the human (default 1)\n"
+        "replies: ok <id>, move <id> <square|pass>, pass <id> (the human must pass),\n"
+        "  turn <id> (the human to move), over <id> <black> <white>, board <id> <position>,\n"
+        "  analysis <id> <depth> <k> and k lines line <id> <square> <score> <pv...>,\n"
+        "  error <id> <message>\n"
+        "  show <id> | end <id> | stats | exit\n");
+}
+
+int main(int argc, char** argv) {
+    static Thread threads[MAX_WORKERS];
+    Server server;
+    int workers = 4;
+    const char* book = NULL;
+    const char* solved = NULL;
+    const char* weights = NULL;
+    char line[LINE_SIZE];
+
+    memset(&server, 0, sizeof(server));
+    server.free_head = server.queue_head = server.queue_tail = NO_SESSION;
+    server.seed = 1;
+    set_search_time(100);
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            const char* value = argv[++i];
+            switch (argv[i - 1][1]) {
+            case 'j': workers = atoi(value); break;
+            case 'm': set_search_time(atoi(value)); break;
+            case 'h': set_hash_size(atoi(value)); break;
+            case 'b': book = value; break;
+            case 'd': solved = value; break;
+            case 'w': weights = value; break;
+            case 'x':
+                if (!(server.stats = fopen(value, "w"))) {
+                    fprintf(stderr, "cannot create %s\n", value);
+                    return 1;
+                }
+                break;
+            case 's': server.seed = strtoull(value, NULL, 10); break;
+            default: usage(); return 1;
+            }
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (book && !set_book(book)) {
+        fprintf(stderr, "cannot open book %s\n", book);
+        return 1;
+    }
+    if (!book) set_book(BOOK_DEFAULT_FILE);
+    if (weights && !set_weights(weights)) {
+        fprintf(stderr, "cannot load weights %s\n", weights);
+        return 1;
+    }
+    if (!weights) set_weights(EVAL_DEFAULT_FILE);
+    if (solved && !set_solved_db(solved)) {
+        fprintf(stderr, "cannot open solved database %s\n", solved);
+        return 1;
+    }
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+    search_limits_init(&server.limits, SEARCH);
+    // Shared tables are set up here, -h or not, before any worker can race to do it.
+    tt_ensure();
+    eval_init();
+
+    mutex_init(&server.lock);
+    mutex_init(&server.out);
+    cond_init(&server.work);
+    for (int i = 0; i < workers; i++)
+        if (!thread_start(&threads[i], worker_main, &server)) workers = i;
+    if (workers == 0) {
+        fprintf(stderr, "cannot start worker threads\n");
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), stdin)) {
+        char* cmd = strtok(line, " \t\r\n");
+        char* a = strtok(NULL, " \t\r\n");
+        char* b = strtok(NULL, " \t\r\n");
+
+        if (!cmd) continue;
+        if (strcmp(cmd, "new") == 0) command_new(&server, a, b);
+        else if (strcmp(cmd, "move") == 0) command_move(&server, a, b);
+        else if (strcmp(cmd, "analyze") == 0) command_analyze(&server, a, b);
+        else if (strcmp(cmd, "show") == 0) command_show(&server, a);
+        else if (strcmp(cmd, "end") == 0) command_end(&server, a);
+        else if (strcmp(cmd, "stats") == 0) command_stats(&server);
+        else if (strcmp(cmd, "exit") == 0) break;
+        else reply(&server, "error - unknown command %s", cmd);
+    }
+
+    // Queued moves are still played and answered before the workers stop.
+    mutex_lock(&server.lock);
+    server.shutdown = 1;
+    cond_broadcast(&server.work);
+    mutex_unlock(&server.lock);
+    for (int i = 0; i < workers; i++) thread_join(&threads[i]);
+    cond_destroy(&server.work);
+    mutex_destroy(&server.out);
+    mutex_destroy(&server.lock);
+    free(server.sessions);
+    if (server.stats) fclose(server.stats);
+    return 0;
+}
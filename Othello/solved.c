@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "solved.h"
+#include "symmetry.h"
+
+#define SOLVED_PASS 64
+#define MIN_CAPACITY 1024
+#define RECORD_SIZE 16
+
+static const char solved_magic[8] = { 'O', 'T', 'H', 'S', 'O', 'L', 'V', '1' };
+
+// Open addressing with linear probing, kept at most half full. Key 0 marks an empty slot;
+// a position whose key is 0 is simply never stored.
+static SolvedRecord* table;
+static size_t capacity;
+static size_t count;
+static FILE* log_file;
+static RwLock lock;
+static int lock_ready;
+
+static SolvedRecord* find_slot(SolvedRecord* slots, size_t size, uint64_t key) {
+    size_t i = (size_t)key & (size - 1);
+    while (slots[i].key && slots[i].key != key) i = (i + 1) & (size - 1);
+    return &slots[i];
+}
+
+static int grow(void) {
+    size_t size = capacity ? capacity * 2 : MIN_CAPACITY;
+    SolvedRecord* slots = calloc(size, sizeof(SolvedRecord));
+
+    if (!slots) return 0;
+    for (size_t i = 0; i < capacity; i++)
+        if (table[i].key) *find_slot(slots, size, table[i].key) = table[i];
+    free(table);
+    table = slots;
+    capacity = size;
+    return 1;
+}
+
+// The on-disk form of a record: key, score, move, empties, reserved byte, solve time.
+static void encode(const SolvedRecord* record, unsigned char* p) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(record->key >> (8 * i));
+    p[8] = (unsigned char)record->score;
+    p[9] = record->move;
+    p[10] = record->empties;
+    p[11] = record->reserved;
+    for (int i = 0; i < 4; i++) p[12 + i] = (unsigned char)(record->solve_ms >> (8 * i));
+}
+
+static void decode(const unsigned char* p, SolvedRecord* record) {
+    record->key = 0;
+    for (int i = 0; i < 8; i++) record->key |= (uint64_t)p[i] << (8 * i);
+    record->score = (int8_t)p[8];
+    record->move = p[9];
+    record->empties = p[10];
+    record->reserved = p[11];
+    record->solve_ms = 0;
+    for (int i = 0; i < 4; i++) record->solve_ms |= (uint32_t)p[12 + i] << (8 * i);
+}
+
+// Adds record unless its key is already present; 1 if it was added.
+static int insert(const SolvedRecord* record) {
+    if (!record->key) return 0;
+    if ((count + 1) * 2 > capacity && !grow()) return 0;
+
+    SolvedRecord* slot = find_slot(table, capacity, record->key);
+    if (slot->key) return 0;
+    *slot = *record;
+    count++;
+    return 1;
+}
+
+int solved_open(const char* path) {
+    size_t size = 0;
+    const char* p = map_file(path, &size);
+
+    solved_close();
+    if (!lock_ready) {
+        rwlock_init(&lock);
+        lock_ready = 1;
+    }
+    if (p) {
+        if (size < sizeof(solved_magic) || memcmp(p, solved_magic, sizeof(solved_magic)) != 0) {
+            unmap_file(p, size);
+            return 0;
+        }
+        size_t n = (size - sizeof(solved_magic)) / RECORD_SIZE;
+        size_t whole = sizeof(solved_magic) + n * RECORD_SIZE;
+        for (size_t i = 0; i < n; i++) {
+            SolvedRecord record;
+            decode((const unsigned char*)p + sizeof(solved_magic) + i * RECORD_SIZE, &record);
+            insert(&record);
+        }
+        unmap_file(p, size);
+        // A record cut short by a crash mid-append is dropped, and cut off the file so that
+        // the records appended after it stay in step.
+        if (whole != size && !truncate_file(path, whole)) {
+            solved_close();
+            return 0;
+        }
+    }
+
+    log_file = fopen(path, "ab");
+    if (!log_file || (!p && fwrite(solved_magic, sizeof(solved_magic), 1, log_file) != 1) || fflush(log_file) != 0) {
+        solved_close();
+        return 0;
+    }
+    if (!table && !grow()) {
+        solved_close();
+        return 0;
+    }
+    return 1;
+}
+
+void solved_close(void) {
+    if (log_file) fclose(log_file);
+    log_file = NULL;
+    free(table);
+    table = NULL;
+    capacity = 0;
+    count = 0;
+}
+
+int solved_ready(void) {
+    return log_file != NULL;
+}
+
+size_t solved_size(void) {
+    size_t n;
+
+    if (!log_file) return 0;
+    rwlock_read_lock(&lock);
+    n = count;
+    rwlock_read_unlock(&lock);
+    return n;
+}
+
+int solved_probe(const Position* pos, int* score, int* move) {
+    int sym;
+    uint64_t key;
+    SolvedRecord record;
+
+    if (!log_file) return 0;
+    key = bb_canonical_key(pos, &sym);
+    rwlock_read_lock(&lock);
+    record = *find_slot(table, capacity, key);
+    rwlock_read_unlock(&lock);
+
+    if (!key || record.key != key) return 0;
+    *score = record.score;
+    *move = record.move == SOLVED_PASS ? -1 : sym_square(record.move, sym_inverse(sym));
+    return 1;
+}
+
+void solved_store(const Position* pos, int score, int move, int64_t solve_ms) {
+    int empties = 64 - bb_count(pos->own | pos->opp);
+    int sym;
+    SolvedRecord record;
+    unsigned char bytes[RECORD_SIZE];
+
+    if (!log_file || empties < SOLVED_MIN_EMPTIES) return;
+    memset(&record, 0, sizeof(record));
+    record.key = bb_canonical_key(pos, &sym);
+    record.score = (int8_t)score;
+    record.move = (uint8_t)(move < 0 ? SOLVED_PASS : sym_square(move, sym));
+    record.empties = (uint8_t)empties;
+    record.solve_ms = solve_ms > UINT32_MAX ? UINT32_MAX : (uint32_t)solve_ms;
+
+    // Each record goes out in one write to a file opened for append, so processes sharing
+    // the file interleave whole records; each sees the others' solves when it next opens it.
+    rwlock_write_lock(&lock);
+    if (insert(&record)) {
+        encode(&record, bytes);
+        fwrite(bytes, sizeof(bytes), 1, log_file);
+        fflush(log_file);
+    }
+    rwlock_write_unlock(&lock);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef SOLVED_H
+#define SOLVED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bitboard.h"
+
+#define SOLVED_DEFAULT_FILE "othello.solved"
+// Positions with fewer empties are solved faster than they are looked up and written.
+#define SOLVED_MIN_EMPTIES 14
+
+// Exact endgame results kept across runs. On disk (little-endian) an 8-byte magic
+// "OTHSOLV1" and then records in the order they were solved; the whole file is loaded
+// into a hash index when opened and every new solve is appended as it is found. Keys
+// are canonical, so a position and its symmetric images share one record.
+typedef struct {
+    uint64_t key;       // bb_canonical_key of the position
+    int8_t score;       // exact final disc difference for the side to move
+    uint8_t move;       // best square in the canonical frame, 64 when it must pass
+    uint8_t empties;
+    uint8_t reserved;
+    uint32_t solve_ms;  // what the solve cost, for reporting the time the database saves
+} SolvedRecord;
+
+// Loads the database at path, creating it if missing, and appends new solves to it;
+// 0 if it cannot be created or is malformed. Probes and stores are safe from any number
+// of threads once it is open; opening and closing are not.
+int solved_open(const char* path);
+void solved_close(void);
+int solved_ready(void);
+size_t solved_size(void);
+// Exact score and best move (-1 for a pass) of pos if it has been solved.
+int solved_probe(const Position* pos, int* score, int* move);
+// Records an exact result with at least SOLVED_MIN_EMPTIES empties; others are ignored.
+void solved_store(const Position* pos, int score, int move, int64_t solve_ms);
+
+#endif
@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include "stats.h"
+
+static double ratio(uint64_t a, uint64_t b) {
+    return b ? (double)a / (double)b : 0.0;
+}
+
+int stats_format_json(const SearchStats* s, char* out, size_t size) {
+    int n = snprintf(out, size, "\"nodes\":%llu,\"depth\":%d,\"time_ms\":%lld",
+        (unsigned long long)s->nodes, s->depth, (long long)s->time_ms);
+
+    if (!STATS_ENABLED || n < 0 || (size_t)n >= size) return n;
+    return n + snprintf(out + n, size - (size_t)n,
+        ",\"tt_probes\":%llu,\"tt_hit_rate\":%.4f,\"first_cutoff_rate\":%.4f,\"branching\":%.2f"
+        ",\"movegen_share\":%.4f,\"eval_share\":%.4f,\"ticks\":%llu",
+        (unsigned long long)s->tt_probes, ratio(s->tt_hits, s->tt_probes), ratio(s->first_cutoffs, s->cutoffs),
+        ratio(s->children, s->expanded), ratio(s->movegen_ticks, s->ticks), ratio(s->eval_ticks, s->ticks),
+        (unsigned long long)s->ticks);
+}
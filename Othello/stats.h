@@ -0,0 +1,54 @@
+#pragma once
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+// Per-move search counters. nodes, depth and time_ms are always filled in; the rest only
+// when built with -DOTHELLO_STATS. Without it the STAT_ macros expand to nothing, so the
+// search and solver hot paths carry no counting, timing or extra branches.
+typedef struct {
+    uint64_t nodes;
+    int depth;
+    int64_t time_ms;
+    uint64_t tt_probes, tt_hits;
+    uint64_t expanded;          // nodes whose moves were generated
+    uint64_t children;          // legal moves at those nodes
+    uint64_t cutoffs;           // beta cutoffs
+    uint64_t first_cutoffs;     // ... of which by the first move tried
+    uint64_t movegen_ticks;     // in bb_moves
+    uint64_t eval_ticks;        // in the static evaluation
+    uint64_t ticks;             // the whole move, in the same units
+} SearchStats;
+
+#ifdef OTHELLO_STATS
+#define STATS_ENABLED 1
+#define STAT_ADD(stats, field, n) ((stats)->field += (uint64_t)(n))
+#define STAT_START(t) uint64_t t = now_ticks()
+#define STAT_ELAPSED(stats, field, t) ((stats)->field += now_ticks() - (t))
+#else
+#define STATS_ENABLED 0
+#define STAT_ADD(stats, field, n) ((void)sizeof((stats)->field + (n)))
+#define STAT_START(t)
+#define STAT_ELAPSED(stats, field, t) ((void)0)
+#endif
+
+// Adds the counters of s to total; nodes, depth and time_ms are left to the caller.
+static inline void stats_add(SearchStats* total, const SearchStats* s) {
+    total->tt_probes += s->tt_probes;
+    total->tt_hits += s->tt_hits;
+    total->expanded += s->expanded;
+    total->children += s->children;
+    total->cutoffs += s->cutoffs;
+    total->first_cutoffs += s->first_cutoffs;
+    total->movegen_ticks += s->movegen_ticks;
+    total->eval_ticks += s->eval_ticks;
+}
+
+// Writes s as the fields of a JSON object, without braces, so callers can put their own
+// fields around it: "nodes":...,"depth":...,... Rates and shares are fractions.
+int stats_format_json(const SearchStats* s, char* out, size_t size);
+
+#endif
@@ -0,0 +1,66 @@
+#include "symmetry.h"
+
+int sym_square(int sq, int sym) {
+    int row = sq / 8, col = sq % 8;
+
+    if (sym & 4) {
+        int t = row;
+        row = col;
+        col = t;
+    }
+    if (sym & 1) col = 7 - col;
+    if (sym & 2) row = 7 - row;
+    return SQ(row, col);
+}
+
+int bb_canonical(uint64_t own, uint64_t opp, uint64_t* cown, uint64_t* copp) {
+    // The eight images are built from two mirrors and one transpose each way round.
+    uint64_t o[SYM_COUNT], p[SYM_COUNT];
+    int best = 0;
+
+    o[0] = own;
+    p[0] = opp;
+    o[4] = bb_transpose(own);
+    p[4] = bb_transpose(opp);
+    for (int base = 0; base < SYM_COUNT; base += 4) {
+        o[base | 1] = bb_mirror_horizontal(o[base]);
+        p[base | 1] = bb_mirror_horizontal(p[base]);
+        o[base | 2] = bb_flip_vertical(o[base]);
+        p[base | 2] = bb_flip_vertical(p[base]);
+        o[base | 3] = bb_flip_vertical(o[base | 1]);
+        p[base | 3] = bb_flip_vertical(p[base | 1]);
+    }
+    for (int i = 1; i < SYM_COUNT; i++)
+        if (o[i] < o[best] || (o[i] == o[best] && p[i] < p[best])) best = i;
+
+    *cown = o[best];
+    *copp = p[best];
+    return best;
+}
+
+// splitmix64 finaliser: every input bit affects every output bit.
+static inline uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t bb_canonical_key(const Position* pos, int* sym) {
+    uint64_t own, opp;
+    int s = bb_canonical(pos->own, pos->opp, &own, &opp);
+
+    if (sym) *sym = s;
+    return mix(own ^ mix(opp + 0x9e3779b97f4a7c15ULL));
+}
+
+int sym_canonical_move(const Position* pos, int sq) {
+    uint64_t own, opp;
+    int best = 64;
+
+    bb_canonical(pos->own, pos->opp, &own, &opp);
+    for (int sym = 0; sym < SYM_COUNT; sym++) {
+        int t = sym_square(sq, sym);
+        if (t < best && bb_transform(pos->own, sym) == own && bb_transform(pos->opp, sym) == opp) best = t;
+    }
+    return best;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <stdint.h>
+#include "bitboard.h"
+
+// The eight board symmetries are numbered by three bits applied in this order:
+// 4 = transpose (row <-> col), 1 = mirror columns, 2 = mirror rows. 0 is the identity.
+#define SYM_COUNT 8
+
+static inline uint64_t delta_swap(uint64_t b, uint64_t mask, int delta) {
+    uint64_t t = (b ^ (b >> delta)) & mask;
+    return b ^ t ^ (t << delta);
+}
+
+// Row r goes to row 7 - r.
+static inline uint64_t bb_flip_vertical(uint64_t b) {
+    b = delta_swap(b, 0x00000000ffffffffULL, 32);
+    b = delta_swap(b, 0x0000ffff0000ffffULL, 16);
+    return delta_swap(b, 0x00ff00ff00ff00ffULL, 8);
+}
+
+// Column c goes to column 7 - c.
+static inline uint64_t bb_mirror_horizontal(uint64_t b) {
+    b = delta_swap(b, 0x5555555555555555ULL, 1);
+    b = delta_swap(b, 0x3333333333333333ULL, 2);
+    return delta_swap(b, 0x0f0f0f0f0f0f0f0fULL, 4);
+}
+
+// Square (r, c) goes to (c, r).
+static inline uint64_t bb_transpose(uint64_t b) {
+    b = delta_swap(b, 0x00aa00aa00aa00aaULL, 7);
+    b = delta_swap(b, 0x0000cccc0000ccccULL, 14);
+    return delta_swap(b, 0x00000000f0f0f0f0ULL, 28);
+}
+
+static inline uint64_t bb_transform(uint64_t b, int sym) {
+    if (sym & 4) b = bb_transpose(b);
+    if (sym & 1) b = bb_mirror_horizontal(b);
+    if (sym & 2) b = bb_flip_vertical(b);
+    return b;
+}
+
+// Transpose commutes with neither mirror but swaps one for the other.
+static inline int sym_inverse(int sym) {
+    return sym & 4 ? 4 | (sym & 1) << 1 | (sym & 2) >> 1 : sym;
+}
+
+// Where square sq lands under sym.
+int sym_square(int sq, int sym);
+
+// Symmetry of (own, opp) with the smallest (own, opp) pair; every position equivalent
+// under the board symmetries has the same canonical form. Stores it in cown and copp.
+int bb_canonical(uint64_t own, uint64_t opp, uint64_t* cown, uint64_t* copp);
+
+// Key of the canonical form from the mover's point of view, so it does not depend on the
+// colour to move either. sym, if not NULL, receives the symmetry that was applied:
+// a move sq in pos is sym_square(sq, *sym) in the canonical frame.
+uint64_t bb_canonical_key(const Position* pos, int* sym);
+
+// sq in the canonical frame. When the position is itself symmetric, equivalent moves all
+// map to the same (lowest) square, so statistics for them land on one entry.
+int sym_canonical_move(const Position* pos, int sq);
+
+#endif
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "tt.h"
+#include "platform.h"
+
+#define BUCKET_ENTRIES 4
+
+typedef struct {
+    uint64_t check;     // key ^ data
+    uint64_t data;
+} TTSlot;
+
+// One cache line per bucket.
+typedef struct {
+    TTSlot slot[BUCKET_ENTRIES];
+} TTBucket;
+
+static TTBucket* table;
+static uint64_t bucket_mask;
+// Bumped by whichever search starts while others may be probing and storing, so it is
+// only touched atomically; entries keep its low byte.
+static volatile int32_t generation;
+
+int tt_init(size_t mb) {
+    size_t buckets = 1;
+    while (buckets * 2 * sizeof(TTBucket) <= mb * 1024 * 1024) buckets *= 2;
+
+    tt_free();
+    table = aligned_malloc(buckets * sizeof(TTBucket), 64);
+    if (!table) return 0;
+    bucket_mask = buckets - 1;
+    tt_clear();
+    return 1;
+}
+
+static Once default_once = ONCE_INIT;
+
+static void default_table(void) {
+    if (!table) tt_init(TT_DEFAULT_MB);
+}
+
+void tt_ensure(void) {
+    run_once(&default_once, default_table);
+}
+
+void tt_free(void) {
+    if (table) aligned_free(table);
+    table = NULL;
+    bucket_mask = 0;
+}
+
+int tt_ready(void) {
+    return table != NULL;
+}
+
+void tt_clear(void) {
+    if (table) memset(table, 0, (bucket_mask + 1) * sizeof(TTBucket));
+}
+
+void tt_new_search(void) {
+    atomic_add32(&generation, 1);
+}
+
+// data layout: score (16 bits) | depth (8) | bound (8) | move (8) | generation (8)
+static inline uint64_t pack(int depth, int bound, int score, int move, uint8_t age) {
+    return (uint64_t)(uint16_t)score | (uint64_t)(uint8_t)depth << 16 | (uint64_t)(uint8_t)bound << 24
+        | (uint64_t)(uint8_t)move << 32 | (uint64_t)age << 40;
+}
+
+static inline int data_depth(uint64_t data) { return (int8_t)(data >> 16); }
+static inline int data_bound(uint64_t data) { return (uint8_t)(data >> 24); }
+static inline int data_move(uint64_t data) { return (int8_t)(data >> 32); }
+static inline uint8_t data_generation(uint64_t data) { return (uint8_t)(data >> 40); }
+
+int tt_probe(uint64_t key, TTEntry* entry) {
+    volatile TTSlot* slot = table[key & bucket_mask].slot;
+    for (int i = 0; i < BUCKET_ENTRIES; i++) {
+        uint64_t data = slot[i].data;
+        uint64_t check = slot[i].check;
+        if ((check ^ data) == key && data_bound(data) != TT_NONE) {
+            entry->score = (int16_t)data;
+            entry->depth = data_depth(data);
+            entry->bound = data_bound(data);
+            entry->move = data_move(data);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void tt_store(uint64_t key, int depth, int bound, int score, int move) {
+    volatile TTSlot* slot = table[key & bucket_mask].slot;
+    int replace = 0;
+    uint64_t replace_data = slot[0].data;
+    uint8_t age = (uint8_t)atomic_load32(&generation);
+
+    for (int i = 0; i < BUCKET_ENTRIES; i++) {
+        uint64_t data = slot[i].data;
+        if ((slot[i].check ^ data) == key || data_bound(data) == TT_NONE) {
+            // Keep a known best move when re-storing the same position without one.
+            if (move < 0 && data_bound(data) != TT_NONE) move = data_move(data);
+            replace = i;
+            break;
+        }
+        // Prefer entries left over from older searches, then the shallowest.
+        int e_old = data_generation(data) != age;
+        int r_old = data_generation(replace_data) != age;
+        if (e_old > r_old || (e_old == r_old && data_depth(data) < data_depth(replace_data))) {
+            replace = i;
+            replace_data = data;
+        }
+    }
+
+    uint64_t data = pack(depth, bound, score, move, age);
+    slot[replace].data = data;
+    slot[replace].check = key ^ data;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef TT_H
+#define TT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TT_DEFAULT_MB 16
+
+enum {
+    TT_NONE,
+    TT_UPPER,   // score <= stored value (fail low)
+    TT_LOWER,   // score >= stored value (fail high)
+    TT_EXACT
+};
+
+// Decoded table entry as returned by tt_probe.
+typedef struct {
+    int score;
+    int depth;
+    int bound;
+    int move;       // best square, -1 if unknown
+} TTEntry;
+
+// The table is shared by all search threads without locks: each slot stores key ^ data,
+// so a slot torn by concurrent writers fails validation instead of returning garbage.
+
+// Allocates the table with about mb megabytes (rounded down to a power of two of 64-byte
+// buckets), replacing any previous one: for program setup, while no search is running.
+int tt_init(size_t mb);
+// Allocates a TT_DEFAULT_MB table unless tt_init already made one. Safe from any number of
+// threads at once; it never frees or replaces a table, so searches may call it freely.
+void tt_ensure(void);
+void tt_free(void);
+int tt_ready(void);
+void tt_clear(void);
+// Ages the table so entries from earlier searches are replaced first.
+void tt_new_search(void);
+int tt_probe(uint64_t key, TTEntry* entry);
+void tt_store(uint64_t key, int depth, int bound, int score, int move);
+
+#endif
@@ -0,0 +1,383 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "bitboard.h"
+#include "eval.h"
+#include "platform.h"
+#include "record.h"
+
+#define MAX_WORKERS 64
+// Evaluation units per disc of final margin; the default tables are on about this scale.
+#define TUNE_SCALE 16
+#define CHUNK 256
+
+// Training positions as struct-of-arrays sorted by phase, so the fitting loop streams
+// each column once per pass and works on one phase's tables at a time.
+typedef struct {
+    size_t count;
+    size_t phase_start[EVAL_PHASES + 1];
+    uint16_t* index[EVAL_FEATURES];
+    int8_t* terms[EVAL_TERMS];
+    int8_t* target;         // final disc difference for the side to move
+} Samples;
+
+// One position as it is extracted, before the columns are built.
+typedef struct {
+    uint16_t index[EVAL_FEATURES];
+    int8_t terms[EVAL_TERMS];
+    int8_t target;
+    int8_t phase;
+} Row;
+
+typedef struct {
+    Row* rows;
+    size_t count, capacity;
+} RowList;
+
+typedef struct {
+    float weight[EVAL_PHASES][EVAL_WEIGHTS];
+    float coef[EVAL_PHASES][EVAL_TERMS];
+} Model;
+
+// A worker's slice of the samples and its private gradient.
+typedef struct {
+    const Samples* samples;
+    const Model* model;
+    size_t begin, end;
+    double grad[EVAL_PHASES][EVAL_WEIGHTS];
+    double coef_grad[EVAL_PHASES][EVAL_TERMS];
+    double sse;
+    Thread thread;
+} Worker;
+
+static int add_row(RowList* list, const Row* row) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1 << 16;
+        Row* rows = realloc(list->rows, capacity * sizeof(Row));
+        if (!rows) return 0;
+        list->rows = rows;
+        list->capacity = capacity;
+    }
+    list->rows[list->count++] = *row;
+    return 1;
+}
+
+// Every position of the game where the side to move has a move, seen with the side to
+// move as black so one set of tables serves both colours. Returns 0 on an illegal move,
+// having taken back the rows the game added before it.
+static int extract_game(const GameRecord* game, RowList* list) {
+    Position pos;
+    int black_diff = game->discs[0] - game->discs[1];
+    size_t first = list->count;
+
+    bb_set_position(&pos, 0x0000000810000000ULL, 0x0000001008000000ULL, BLACK);
+    for (int ply = 0; ply < game->plies; ply++) {
+        int sq = game->moves[ply];
+        Undo undo;
+
+        if (sq == RECORD_PASS) {
+            bb_pass(&pos);
+            continue;
+        }
+        if (!(bb_moves(pos.own, pos.opp) & SQ_BIT(sq))) {
+            list->count = first;
+            return 0;
+        }
+
+        Position mover = { pos.own, pos.opp, 0, BLACK };
+        int terms[EVAL_TERMS];
+        Row row;
+        eval_features(&mover, row.index, terms);
+        for (int k = 0; k < EVAL_TERMS; k++) row.terms[k] = (int8_t)terms[k];
+        row.target = (int8_t)(pos.color == BLACK ? black_diff : -black_diff);
+        row.phase = (int8_t)EVAL_PHASE(64 - bb_count(pos.own | pos.opp));
+        if (!add_row(list, &row)) {
+            list->count = first;
+            return 0;
+        }
+        bb_make_move(&pos, sq, &undo);
+    }
+    return 1;
+}
+
+static int build_samples(const RowList* list, Samples* samples) {
+    size_t n = list->count;
+    size_t next[EVAL_PHASES];
+
+    samples->count = n;
+    for (int f = 0; f < EVAL_FEATURES; f++)
+        if (!(samples->index[f] = malloc(n * sizeof(uint16_t) + 1))) return 0;
+    for (int k = 0; k < EVAL_TERMS; k++)
+        if (!(samples->terms[k] = malloc(n + 1))) return 0;
+    if (!(samples->target = malloc(n + 1))) return 0;
+
+    for (int p = 0; p <= EVAL_PHASES; p++) samples->phase_start[p] = 0;
+    for (size_t i = 0; i < n; i++) samples->phase_start[list->rows[i].phase + 1]++;
+    for (int p = 0; p < EVAL_PHASES; p++) samples->phase_start[p + 1] += samples->phase_start[p];
+    for (int p = 0; p < EVAL_PHASES; p++) next[p] = samples->phase_start[p];
+
+    for (size_t i = 0; i < n; i++) {
+        const Row* row = &list->rows[i];
+        size_t j = next[row->phase]++;
+        for (int f = 0; f < EVAL_FEATURES; f++) samples->index[f][j] = row->index[f];
+        for (int k = 0; k < EVAL_TERMS; k++) samples->terms[k][j] = row->terms[k];
+        samples->target[j] = row->target;
+    }
+    return 1;
+}
+
+static void free_samples(Samples* samples) {
+    for (int f = 0; f < EVAL_FEATURES; f++) free(samples->index[f]);
+    for (int k = 0; k < EVAL_TERMS; k++) free(samples->terms[k]);
+    free(samples->target);
+}
+
+// Prediction errors for a chunk of one phase, feature by feature across the chunk.
+static void chunk_errors(const Samples* s, const Model* model, int p, size_t base, int m, float* err) {
+    const float* w = model->weight[p];
+
+    for (int j = 0; j < m; j++) err[j] = -(float)(s->target[base + j] * TUNE_SCALE);
+    for (int f = 0; f < EVAL_FEATURES; f++) {
+        const uint16_t* index = s->index[f] + base;
+        for (int j = 0; j < m; j++) err[j] += w[index[j]];
+    }
+    for (int k = 0; k < EVAL_TERMS; k++) {
+        const int8_t* terms = s->terms[k] + base;
+        float c = model->coef[p][k];
+        for (int j = 0; j < m; j++) err[j] += c * terms[j];
+    }
+}
+
+static void gradient_main(void* arg) {
+    Worker* w = arg;
+    const Samples* s = w->samples;
+    float err[CHUNK];
+
+    memset(w->grad, 0, sizeof(w->grad));
+    memset(w->coef_grad, 0, sizeof(w->coef_grad));
+    w->sse = 0;
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        size_t begin = s->phase_start[p] > w->begin ? s->phase_start[p] : w->begin;
+        size_t end = s->phase_start[p + 1] < w->end ? s->phase_start[p + 1] : w->end;
+
+        for (size_t base = begin; base < end; base += CHUNK) {
+            int m = end - base < CHUNK ? (int)(end - base) : CHUNK;
+            chunk_errors(s, w->model, p, base, m, err);
+            for (int j = 0; j < m; j++) w->sse += (double)err[j] * err[j];
+            for (int f = 0; f < EVAL_FEATURES; f++) {
+                const uint16_t* index = s->index[f] + base;
+                for (int j = 0; j < m; j++) w->grad[p][index[j]] += err[j];
+            }
+            for (int k = 0; k < EVAL_TERMS; k++) {
+                const int8_t* terms = s->terms[k] + base;
+                for (int j = 0; j < m; j++) w->coef_grad[p][k] += (double)err[j] * terms[j];
+            }
+        }
+    }
+}
+
+// Sum of squared errors over all samples, split across the workers; gradients are left
+// in the workers.
+static double run_workers(Worker* workers, int n, const Samples* samples, const Model* model) {
+    int started[MAX_WORKERS];
+    double sse = 0;
+
+    for (int i = 0; i < n; i++) {
+        workers[i].samples = samples;
+        workers[i].model = model;
+        workers[i].begin = samples->count * (size_t)i / (size_t)n;
+        workers[i].end = samples->count * (size_t)(i + 1) / (size_t)n;
+    }
+    for (int i = 1; i < n; i++) {
+        started[i] = thread_start(&workers[i].thread, gradient_main, &workers[i]);
+        if (!started[i]) gradient_main(&workers[i]);
+    }
+    gradient_main(&workers[0]);
+    for (int i = 1; i < n; i++)
+        if (started[i]) thread_join(&workers[i].thread);
+    for (int i = 0; i < n; i++) sse += workers[i].sse;
+    return sse;
+}
+
+static double rms_discs(double sse, size_t count) {
+    return count ? sqrt(sse / (double)count) / TUNE_SCALE : 0.0;
+}
+
+static int read_records(const char* path, RowList* train, RowList* test, int holdout, long long* games) {
+    RecordReader* reader = record_reader_open(path);
+    GameRecord game;
+
+    if (!reader) return 0;
+    while (record_read(reader, &game)) {
+        // Every holdout-th game is kept back to measure the fit on unseen games.
+        RowList* list = holdout > 0 && *games % holdout == holdout - 1 ? test : train;
+        if (!extract_game(&game, list)) fprintf(stderr, "%s: skipping game %lld, it does not replay\n", path, *games);
+        (*games)++;
+    }
+    record_reader_close(reader);
+    return 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: othello_tune [options] <record file>...\n"
+        "  -o FILE weight file to write (default othello.weights)\n"
+        "  -w FILE start from this weight file instead of the built-in tables\n"
+        "  -j N   threads (default 1)\n"
+        "  -i N   gradient steps (default 200)\n"
+        "  -r X   step size (default 0.2)\n"
+        "  -l X   pull of each weight towards its starting value, in positions (default 20)\n"
+        "  -t N   keep every N-th game back to measure the fit, 0 = none (default 10)\n");
+}
+
+int main(int argc, char** argv) {
+    static Worker workers[MAX_WORKERS];
+    static Model model, start_model;
+    static float hessian[EVAL_PHASES][EVAL_WEIGHTS];
+    static int swapped[EVAL_WEIGHTS];
+    const char* out = EVAL_DEFAULT_FILE;
+    const char* initial = NULL;
+    int threads = 1, iterations = 200, holdout = 10;
+    double rate = 0.2, prior = 20;
+    RowList train_rows = { 0 }, test_rows = { 0 };
+    Samples train, test;
+    long long games = 0;
+    double coef_hessian[EVAL_PHASES][EVAL_TERMS] = { { 0 } };
+    int files = 0;
+
+    eval_init();
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && i + 1 < argc) {
+            const char* value = argv[++i];
+            switch (argv[i - 1][1]) {
+            case 'o': out = value; break;
+            case 'w': initial = value; break;
+            case 'j': threads = atoi(value); break;
+            case 'i': iterations = atoi(value); break;
+            case 'r': rate = atof(value); break;
+            case 'l': prior = atof(value); break;
+            case 't': holdout = atoi(value); break;
+            default: usage(); return 1;
+            }
+        }
+        else {
+            argv[files++] = argv[i];    // file names move to the front of argv
+        }
+    }
+    if (!files) {
+        usage();
+        return 1;
+    }
+    if (initial && !eval_load(initial)) {
+        fprintf(stderr, "cannot load weights %s\n", initial);
+        return 1;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_WORKERS) threads = MAX_WORKERS;
+
+    int64_t start = now_ms();
+    for (int i = 0; i < files; i++) {
+        if (!read_records(argv[i], &train_rows, &test_rows, holdout, &games)) {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (!build_samples(&train_rows, &train) || !build_samples(&test_rows, &test)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    free(train_rows.rows);
+    free(test_rows.rows);
+    if (train.count == 0) {
+        fprintf(stderr, "no positions to fit\n");
+        return 1;
+    }
+    printf("%lld games, %zu training and %zu test positions (%.2f s)\n", games, train.count, test.count,
+        (now_ms() - start) / 1000.0);
+
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        for (int i = 0; i < EVAL_WEIGHTS; i++) model.weight[p][i] = eval_weights[p][i];
+        model.coef[p][0] = (float)eval_mobility[p];
+        model.coef[p][1] = (float)eval_potential[p];
+        model.coef[p][2] = (float)eval_frontier[p];
+    }
+    start_model = model;
+    for (int i = 0; i < EVAL_WEIGHTS; i++) swapped[i] = eval_swapped_index(i);
+
+    // Diagonal of the least-squares Hessian: how often each weight is used, and the
+    // squared size of each term. A step divides the gradient by it, so rare patterns and
+    // common ones move at the same relative speed.
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        for (size_t j = train.phase_start[p]; j < train.phase_start[p + 1]; j++) {
+            for (int f = 0; f < EVAL_FEATURES; f++) hessian[p][train.index[f][j]] += 1;
+            for (int k = 0; k < EVAL_TERMS; k++) coef_hessian[p][k] += (double)train.terms[k][j] * train.terms[k][j];
+        }
+    }
+
+    double test_before = test.count ? rms_discs(run_workers(workers, threads, &test, &model), test.count) : 0;
+    start = now_ms();
+    for (int it = 0; it <= iterations; it++) {
+        double sse = run_workers(workers, threads, &train, &model);
+        if (it % 20 == 0 || it == iterations)
+            printf("step %4d  rms error %.3f discs\n", it, rms_discs(sse, train.count));
+        if (it == iterations) break;
+
+        for (int i = 1; i < threads; i++) {
+            for (int p = 0; p < EVAL_PHASES; p++) {
+                for (int j = 0; j < EVAL_WEIGHTS; j++) workers[0].grad[p][j] += workers[i].grad[p][j];
+                for (int k = 0; k < EVAL_TERMS; k++) workers[0].coef_grad[p][k] += workers[i].coef_grad[p][k];
+            }
+        }
+
+        // A pattern and its colour-swapped image share one parameter, w and -w, which keeps
+        // the tables antisymmetric as eval_batch and eval_load require.
+        for (int p = 0; p < EVAL_PHASES; p++) {
+            float* w = model.weight[p];
+            const float* w0 = start_model.weight[p];
+            const double* g = workers[0].grad[p];
+            for (int i = 0; i < EVAL_WEIGHTS; i++) {
+                int j = swapped[i];
+                if (j < i) continue;
+                if (j == i) {
+                    w[i] = 0;
+                    continue;
+                }
+                double grad = g[i] - g[j] + prior * (w[i] - w0[i]);
+                w[i] -= (float)(rate * grad / (hessian[p][i] + hessian[p][j] + prior));
+                w[j] = -w[i];
+            }
+            for (int k = 0; k < EVAL_TERMS; k++) {
+                double grad = workers[0].coef_grad[p][k] + prior * (model.coef[p][k] - start_model.coef[p][k]);
+                model.coef[p][k] -= (float)(rate * grad / (coef_hessian[p][k] + prior));
+            }
+        }
+    }
+    printf("%d steps on %d threads in %.2f s\n", iterations, threads, (now_ms() - start) / 1000.0);
+
+    // Rounded to the engine's integer tables; the test error is measured on those.
+    for (int p = 0; p < EVAL_PHASES; p++) {
+        for (int i = 0; i < EVAL_WEIGHTS; i++) {
+            float w = model.weight[p][i];
+            w = w > 32767 ? 32767 : w < -32767 ? -32767 : w;
+            eval_weights[p][i] = (int16_t)lrintf(w);
+            model.weight[p][i] = eval_weights[p][i];
+        }
+        eval_mobility[p] = (int)lrintf(model.coef[p][0]);
+        eval_potential[p] = (int)lrintf(model.coef[p][1]);
+        eval_frontier[p] = (int)lrintf(model.coef[p][2]);
+        for (int k = 0; k < EVAL_TERMS; k++) model.coef[p][k] = lrintf(model.coef[p][k]);
+    }
+    if (test.count)
+        printf("test rms error %.3f discs before, %.3f after\n", test_before,
+            rms_discs(run_workers(workers, threads, &test, &model), test.count));
+    if (!eval_save(out)) {
+        fprintf(stderr, "cannot write %s\n", out);
+        return 1;
+    }
+    printf("weights written to %s\n", out);
+    free_samples(&train);
+    free_samples(&test);
+    return 0;
+}
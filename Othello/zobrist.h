@@ -0,0 +1,13 @@
+#pragma once
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+// zobrist_disc[0] is for black discs, [1] for white; zobrist_side is mixed in when white is to move.
+extern const uint64_t zobrist_disc[2][64];
+extern const uint64_t zobrist_side;
+
+#define ZOBRIST_INDEX(color) ((color) > 0 ? 0 : 1)
+
+#endif